@@ -1,6 +1,7 @@
 #pragma once
 
 #include "bitboard.h"
+#include "../util/cpu.h"
 
 namespace magic
 {
@@ -53,15 +54,29 @@ constexpr u64 BISHOP[64] = {
     0x0400000260142410ULL, 0x0800633408100500ULL, 0xFC087E8E4BB2F736ULL, 0x43FF9E4EF4CA2C89ULL,
 };
 
-inline i32 get_index(const Entry& entry, u64 occupied)
+// Inline assembly doesn't need the bmi2 target, so this stays inlined in generic code
+inline u64 get_pext(u64 value, u64 mask)
 {
-#ifdef PEXT
-    return _pext_u64(occupied, entry.mask);
+#if defined(__x86_64__) && defined(__GNUC__)
+    u64 result;
+
+    asm ("pextq %2, %1, %0" : "=r" (result) : "r" (value), "rm" (mask));
+
+    return result;
 #else
-    return ((occupied & entry.mask) * entry.magic) >> entry.shift;
+    return 0;
 #endif
 };
 
+inline i32 get_index(const Entry& entry, u64 occupied)
+{
+    if (cpu::pext) {
+        return get_pext(occupied, entry.mask);
+    }
+
+    return ((occupied & entry.mask) * entry.magic) >> entry.shift;
+};
+
 };
 
 namespace attack
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "move.h"
+#include "../util/cpu.h"
 
 namespace bitboard
 {
@@ -98,8 +99,19 @@ constexpr u64 get_pop_bit(u64 bitboard, i8 square)
     return bitboard ^ (1ULL << square);
 };
 
+// Generic builds lack the popcnt target, so the instruction is picked at runtime like pext
 constexpr i32 get_count(u64 bitboard)
 {
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__POPCNT__)
+    if (!std::is_constant_evaluated() && cpu::popcnt) {
+        u64 result;
+
+        asm ("popcntq %1, %0" : "=r" (result) : "rm" (bitboard));
+
+        return i32(result);
+    }
+#endif
+
     return std::popcount(bitboard);
 };
 
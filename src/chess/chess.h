@@ -18,6 +18,7 @@ namespace chess
 
 inline void init()
 {
+    cpu::init();
     zobrist::init();
     attack::init();
     bitboard::init();
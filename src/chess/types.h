@@ -27,10 +27,6 @@
 #include <cctype>
 #include <optional>
 
-#ifdef PEXT
-#include <x86intrin.h>
-#endif
-
 using i8 = int8_t;
 using i16 = int16_t;
 using i32 = int32_t;
@@ -0,0 +1,192 @@
+#pragma once
+
+#include "../engine/search.h"
+
+namespace datagen::batch
+{
+
+// Lines read and evaluated at once
+constexpr usize CHUNK = 1ULL << 20;
+
+// Runs the function on contiguous ranges of indices, one range per thread
+template <typename F>
+inline void parallel(usize count, usize thread_count, F&& function)
+{
+    const usize worker_count = std::max(thread_count, usize(1));
+    const usize range = (count + worker_count - 1) / worker_count;
+
+    std::vector<std::thread> threads;
+
+    for (usize start = 0; start < count; start += range) {
+        threads.emplace_back(function, start, std::min(start + range, count));
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+};
+
+// Checks a fen before it's set, since the board reads it without any checks and the batch eval has room for 32 pieces
+// The board needs 8 ranks of 8 squares, one king per side and at most 32 pieces, the other fields must be readable if they're there
+inline bool is_valid(const std::string& fen)
+{
+    std::stringstream ss(fen);
+    std::string word;
+    std::vector<std::string> data;
+
+    while (std::getline(ss, word, ' '))
+    {
+        data.push_back(word);
+    }
+
+    if (data.empty()) {
+        return false;
+    }
+
+    // Board
+    usize ranks = 1;
+    usize squares = 0;
+    usize pieces = 0;
+    usize kings[2] = { 0, 0 };
+
+    for (char c : data[0]) {
+        if (c >= '1' && c <= '8') {
+            squares += c - '0';
+        }
+        else if (c == '/') {
+            if (squares != 8) {
+                return false;
+            }
+
+            ranks += 1;
+            squares = 0;
+        }
+        else if (std::string("PNBRQKpnbrqk").find(c) != std::string::npos) {
+            squares += 1;
+            pieces += 1;
+            kings[color::WHITE] += c == 'K';
+            kings[color::BLACK] += c == 'k';
+        }
+        else {
+            return false;
+        }
+    }
+
+    if (ranks != 8 || squares != 8 || pieces > 32 || kings[color::WHITE] != 1 || kings[color::BLACK] != 1) {
+        return false;
+    }
+
+    // Color and enpassant square
+    if (data.size() > 1 && data[1] != "w" && data[1] != "b") {
+        return false;
+    }
+
+    if (data.size() > 3 && data[3] != "-" &&
+        (data[3].size() != 2 || data[3][0] < 'a' || data[3][0] > 'h' || data[3][1] < '1' || data[3][1] > '8')) {
+        return false;
+    }
+
+    // Move counters
+    for (usize i = 4; i < std::min(data.size(), usize(6)); ++i) {
+        if (data[i].empty() || data[i].size() > 6 || !std::all_of(data[i].begin(), data[i].end(), [] (char c) { return std::isdigit(c); })) {
+            return false;
+        }
+    }
+
+    return true;
+};
+
+// Rescores a file of fens, one per line, with the loaded net
+// Every line is written back followed by the white relative eval, anything after the fen like the score and result of datagen lines is kept
+// Lines with a fen that can't be read are counted and left out of the output
+inline std::optional<u64> run(const std::string& in, const std::string& out, usize thread_count)
+{
+    std::ifstream input(in);
+    std::ofstream output(out);
+
+    if (!input.is_open() || !output.is_open()) {
+        return {};
+    }
+
+    std::vector<std::string> lines;
+    std::vector<nnue::Position> positions;
+    std::vector<i32> evals;
+
+    u64 count = 0;
+    u64 invalid = 0;
+    u64 time_parse = 0;
+    u64 time_eval = 0;
+
+    const u64 time_start = timer::get_current();
+
+    while (true)
+    {
+        std::string line;
+
+        lines.clear();
+
+        while (lines.size() < CHUNK && std::getline(input, line))
+        {
+            if (line.empty()) {
+                continue;
+            }
+
+            if (!batch::is_valid(line.substr(0, line.find(" | ")))) {
+                invalid += 1;
+                continue;
+            }
+
+            lines.push_back(line);
+        }
+
+        if (lines.empty()) {
+            break;
+        }
+
+        positions.resize(lines.size());
+        evals.resize(lines.size());
+
+        // Parsing the fens costs more than evaluating them, so it's split across the threads too
+        const u64 time_parse_start = timer::get_current_us();
+
+        // Each thread reuses one board, creating a board allocates its history
+        batch::parallel(lines.size(), thread_count, [&] (usize start, usize end) {
+            auto board = Board();
+
+            for (usize i = start; i < end; ++i) {
+                board.set_fen(lines[i].substr(0, lines[i].find(" | ")));
+                positions[i] = nnue::get_position(board);
+            }
+        });
+
+        const u64 time_eval_start = timer::get_current_us();
+
+        nnue::evaluate(positions, evals, thread_count);
+
+        time_parse += time_eval_start - time_parse_start;
+        time_eval += timer::get_current_us() - time_eval_start;
+
+        for (usize i = 0; i < lines.size(); ++i) {
+            output << lines[i] << " | " << (positions[i].color == color::WHITE ? evals[i] : -evals[i]) << "\n";
+        }
+
+        count += lines.size();
+
+        std::cout <<
+            "\rpositions: " << count <<
+            " | invalid: " << invalid <<
+            " | positions/s: " << count * 1000 / std::max(timer::get_current() - time_start, u64(1)) <<
+            " | evals/s: " << count * 1000000 / std::max(time_eval, u64(1)) <<
+            " | parsing: " << time_parse / 1000 << " ms" << std::flush;
+    }
+
+    std::cout << std::endl;
+
+    if (!output.good()) {
+        return {};
+    }
+
+    return invalid;
+};
+
+};
\ No newline at end of file
@@ -0,0 +1,295 @@
+#pragma once
+
+#include "../engine/search.h"
+
+namespace datagen::book
+{
+
+// Finds the legal move of a san token like Nbd7, exd6, e8=Q+ or O-O
+inline std::optional<u16> get_move(Board& board, std::string san)
+{
+    // Removes check marks and annotations
+    while (!san.empty() && (san.back() == '+' || san.back() == '#' || san.back() == '!' || san.back() == '?'))
+    {
+        san.pop_back();
+    }
+
+    const auto moves = move::gen::get_legal(board);
+
+    // Castling moves go from the king to the rook
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+        const bool is_long = san.size() == 5;
+
+        for (const u16& move : moves) {
+            if (move::get_type(move) == move::type::CASTLING && (move::get_to(move) < move::get_from(move)) == is_long) {
+                return move;
+            }
+        }
+
+        return {};
+    }
+
+    // Promotion type, e8=Q or e8Q
+    i8 promotion = piece::type::NONE;
+
+    if (san.size() > 2 && san[san.size() - 2] == '=') {
+        promotion = piece::type::create(san.back());
+        san.resize(san.size() - 2);
+    }
+    else if (san.size() > 2 && std::string("NBRQ").find(san.back()) != std::string::npos) {
+        promotion = piece::type::create(san.back());
+        san.pop_back();
+    }
+
+    // Moving piece, pawn moves start with their file
+    i8 type = piece::type::PAWN;
+    usize start = 0;
+
+    if (!san.empty() && std::string("NBRQK").find(san[0]) != std::string::npos) {
+        type = piece::type::create(san[0]);
+        start = 1;
+    }
+
+    if (san.size() < start + 2) {
+        return {};
+    }
+
+    const i8 to_file = file::create(san[san.size() - 2]);
+    const i8 to_rank = rank::create(san[san.size() - 1]);
+
+    if (to_file == file::NONE || to_rank == rank::NONE) {
+        return {};
+    }
+
+    // Whatever is left between the piece and the square disambiguates it
+    i8 from_file = file::NONE;
+    i8 from_rank = rank::NONE;
+
+    for (usize i = start; i < san.size() - 2; ++i) {
+        if (file::create(san[i]) != file::NONE) {
+            from_file = file::create(san[i]);
+        }
+        else if (rank::create(san[i]) != rank::NONE) {
+            from_rank = rank::create(san[i]);
+        }
+        else if (san[i] != 'x') {
+            return {};
+        }
+    }
+
+    const i8 to = square::create(to_file, to_rank);
+
+    std::optional<u16> result = {};
+
+    for (const u16& move : moves) {
+        const i8 from = move::get_from(move);
+
+        if (move::get_type(move) == move::type::CASTLING ||
+            move::get_to(move) != to ||
+            board.get_type_at(from) != type ||
+            (from_file != file::NONE && square::get_file(from) != from_file) ||
+            (from_rank != rank::NONE && square::get_rank(from) != from_rank)) {
+            continue;
+        }
+
+        if ((move::get_type(move) == move::type::PROMOTION) != (promotion != piece::type::NONE) ||
+            (promotion != piece::type::NONE && move::get_promotion_type(move) != promotion)) {
+            continue;
+        }
+
+        // Ambiguous moves are rejected
+        if (result.has_value()) {
+            return {};
+        }
+
+        result = move;
+    }
+
+    return result;
+};
+
+// One position per line, only the first 4 fields are read unless the move counters follow them, so epd operations are skipped
+inline std::vector<std::string> parse_epd(std::istream& in)
+{
+    std::vector<std::string> fens;
+    std::string line;
+
+    auto is_number = [] (const std::string& token) {
+        return !token.empty() && std::all_of(token.begin(), token.end(), [] (char c) { return std::isdigit(c); });
+    };
+
+    while (std::getline(in, line))
+    {
+        std::stringstream ss(line);
+        std::string token;
+        std::vector<std::string> tokens;
+
+        while (ss >> token)
+        {
+            tokens.push_back(token);
+        }
+
+        if (tokens.size() < 4 || tokens[0].starts_with("#")) {
+            continue;
+        }
+
+        const bool has_counters = tokens.size() >= 6 && is_number(tokens[4]) && is_number(tokens[5]);
+
+        fens.push_back(
+            tokens[0] + " " + tokens[1] + " " + tokens[2] + " " + tokens[3] + " " +
+            (has_counters ? tokens[4] + " " + tokens[5] : "0 1")
+        );
+    }
+
+    return fens;
+};
+
+// The final position of every game, games with a move that can't be read are skipped
+// Comments, variations and numeric annotations are ignored, a FEN tag sets the start position
+inline std::vector<std::string> parse_pgn(std::istream& in)
+{
+    std::vector<std::string> fens;
+
+    const std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    auto board = Board();
+    usize count = 0;
+    bool is_set = false;
+    bool valid = true;
+
+    auto finish = [&] () {
+        if (valid && (count > 0 || is_set)) {
+            fens.push_back(board.get_fen());
+        }
+
+        board = Board();
+        count = 0;
+        is_set = false;
+        valid = true;
+    };
+
+    usize i = 0;
+
+    while (i < text.size())
+    {
+        const char c = text[i];
+
+        if (std::isspace(c)) {
+            i += 1;
+            continue;
+        }
+
+        // Tags, a tag after moves starts the next game
+        if (c == '[') {
+            const usize end = std::min(text.find(']', i), text.size());
+            const auto tag = text.substr(i + 1, end - i - 1);
+
+            if (count > 0) {
+                finish();
+            }
+
+            if (tag.starts_with("FEN ")) {
+                const usize quote_start = tag.find('"');
+                const usize quote_end = tag.rfind('"');
+
+                if (quote_start != std::string::npos && quote_end > quote_start) {
+                    board.set_fen(tag.substr(quote_start + 1, quote_end - quote_start - 1));
+                    board.update_masks();
+                    is_set = true;
+                }
+            }
+
+            i = end + 1;
+            continue;
+        }
+
+        if (c == '{') {
+            i = std::min(text.find('}', i), text.size()) + 1;
+            continue;
+        }
+
+        if (c == ';') {
+            i = std::min(text.find('\n', i), text.size()) + 1;
+            continue;
+        }
+
+        if (c == '(') {
+            i32 depth = 0;
+
+            for (; i < text.size(); ++i) {
+                depth += text[i] == '(' ? 1 : text[i] == ')' ? -1 : 0;
+
+                if (depth == 0) {
+                    break;
+                }
+            }
+
+            i += 1;
+            continue;
+        }
+
+        // Tokens
+        usize end = i;
+
+        while (end < text.size() && !std::isspace(text[end]) && std::string("[{;(").find(text[end]) == std::string::npos)
+        {
+            end += 1;
+        }
+
+        std::string token = text.substr(i, end - i);
+
+        i = end;
+
+        if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*") {
+            finish();
+            continue;
+        }
+
+        if (token.starts_with("$")) {
+            continue;
+        }
+
+        // Move numbers like 12. or 12... may be attached to the move
+        if (!token.starts_with("0-0")) {
+            token.erase(0, token.find_first_not_of("0123456789."));
+        }
+
+        if (token.empty() || !valid) {
+            continue;
+        }
+
+        const auto move = book::get_move(board, token);
+
+        if (!move.has_value()) {
+            valid = false;
+            continue;
+        }
+
+        board.make(move.value());
+        count += 1;
+    }
+
+    finish();
+
+    return fens;
+};
+
+// Reads a book of opening positions, .pgn files are read as games and anything else as epd
+inline std::optional<std::vector<std::string>> load(const std::string& path)
+{
+    std::ifstream in(path);
+
+    if (!in.is_open()) {
+        return {};
+    }
+
+    auto fens = path.ends_with(".pgn") ? book::parse_pgn(in) : book::parse_epd(in);
+
+    if (fens.empty()) {
+        return {};
+    }
+
+    return fens;
+};
+
+};
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <charconv>
+#include "../engine/search.h"
+
+namespace datagen
+{
+
+// Positions writes the kept positions as records, games writes whole games as their moves, see format.h
+enum class Output
+{
+    POSITIONS,
+    GAMES
+};
+
+// Settings of a datagen run, every one can be set on the command line as a name followed by its value
+struct Config
+{
+    u64 threads = 4;
+    Output output = Output::POSITIONS;
+
+    // Search, a soft node limit replaces the fixed depth when it's set
+    i32 depth = 8;
+    u64 nodes = 0;
+
+    // Openings, random plies are played from the start position or from a random book position
+    std::string book = "";
+    usize random = 8;
+    i32 opening_delta = 400;
+
+    // Adjudication, a game is won once the score stays above win_score for win_plies plies
+    // and drawn once it stays within draw_score for draw_plies plies after draw_ply, draw_plies 0 turns it off
+    i32 win_score = 2000;
+    i32 win_plies = 1;
+    i32 draw_score = 10;
+    i32 draw_plies = 0;
+    i32 draw_ply = 80;
+
+    // Limits, the run ends after this many positions or seconds, 0 seconds runs until the position limit
+    usize visit = 400;
+    u64 positions = 200000000;
+    u64 time = 0;
+};
+
+// The hard node limit of a move, searches that blow past the soft limit are cut here
+constexpr u64 NODES_HARD_RATIO = 8;
+
+// History is scaled by this over 1024 between games, it mostly carries over like between moves of a real game
+constexpr i32 HISTORY_DECAY_GAME = 512;
+
+namespace config
+{
+
+// Reads a whole token as a number, gives nothing on anything else like 5k, x or -1 for an unsigned value
+template <typename T>
+inline std::optional<T> get_number(const std::string& value)
+{
+    T number = T();
+
+    const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), number);
+
+    if (error != std::errc() || end != value.data() + value.size()) {
+        return {};
+    }
+
+    return number;
+};
+
+// Reads name value pairs, gives nothing on an unknown name, a missing value or a value that can't be read
+inline std::optional<Config> parse(const std::vector<std::string>& tokens)
+{
+    auto config = Config();
+
+    if (tokens.size() % 2 != 0) {
+        return {};
+    }
+
+    for (usize i = 0; i < tokens.size(); i += 2) {
+        const auto& name = tokens[i];
+        const auto& value = tokens[i + 1];
+
+        // Numbers
+        std::optional<u64> u = {};
+        std::optional<i32> n = {};
+
+        if (name == "output") {
+            if (value != "positions" && value != "games") {
+                return {};
+            }
+
+            config.output = value == "games" ? Output::GAMES : Output::POSITIONS;
+            continue;
+        }
+
+        if (name == "book") {
+            config.book = value;
+            continue;
+        }
+
+        if (name == "threads" || name == "nodes" || name == "random" || name == "visit" || name == "positions" || name == "time") {
+            u = config::get_number<u64>(value);
+
+            if (!u.has_value()) {
+                return {};
+            }
+        }
+        else {
+            n = config::get_number<i32>(value);
+
+            if (!n.has_value()) {
+                return {};
+            }
+        }
+
+        if (name == "threads" && u.value() > 0) {
+            config.threads = u.value();
+        }
+        else if (name == "nodes") {
+            config.nodes = u.value();
+        }
+        else if (name == "random") {
+            config.random = u.value();
+        }
+        else if (name == "visit") {
+            config.visit = u.value();
+        }
+        else if (name == "positions") {
+            config.positions = u.value();
+        }
+        else if (name == "time") {
+            config.time = u.value();
+        }
+        else if (name == "depth" && n.value() >= 1 && n.value() < MAX_PLY) {
+            config.depth = n.value();
+        }
+        else if (name == "opening_delta") {
+            config.opening_delta = n.value();
+        }
+        else if (name == "win_score") {
+            config.win_score = n.value();
+        }
+        else if (name == "win_plies" && n.value() >= 1) {
+            config.win_plies = n.value();
+        }
+        else if (name == "draw_score") {
+            config.draw_score = n.value();
+        }
+        else if (name == "draw_plies" && n.value() >= 0) {
+            config.draw_plies = n.value();
+        }
+        else if (name == "draw_ply") {
+            config.draw_ply = n.value();
+        }
+        else {
+            return {};
+        }
+    }
+
+    return config;
+};
+
+inline void print(const Config& config)
+{
+    std::cout <<
+        "threads " << config.threads <<
+        " | output " << (config.output == Output::GAMES ? "games" : "positions") <<
+        " | " << (config.nodes ? "nodes " + std::to_string(config.nodes) : "depth " + std::to_string(config.depth)) <<
+        " | book " << (config.book.empty() ? "none" : config.book) <<
+        " | random " << config.random <<
+        " | win " << config.win_score << "x" << config.win_plies <<
+        " | draw " << (config.draw_plies ? std::to_string(config.draw_score) + "x" + std::to_string(config.draw_plies) + " after " + std::to_string(config.draw_ply) : "off") <<
+        " | positions " << config.positions <<
+        " | time " << (config.time ? std::to_string(config.time) + " s" : "none") << std::endl;
+};
+
+};
+
+};
@@ -2,6 +2,7 @@
 
 #include <iomanip>
 #include "game.h"
+#include "book.h"
 
 namespace datagen
 {
@@ -12,13 +13,8 @@ namespace datagen
     constexpr bool GENERATING = false;
 #endif
 
-constexpr usize MAX_VISIT = 400;
-constexpr usize MAX_OPENING = 8;
-constexpr usize MAX_POSITION = 200000000;
 constexpr usize SAVE_INTERVAL = 10;
 
-constexpr i32 MAX_OPENING_DELTA = 400;
-
 class Rng
 {
 public:
@@ -37,88 +33,124 @@ public:
     };
 };
 
-inline Board get_random_opening(Rng& rng)
+// Plays random moves from the start position or from a random book position
+inline Board get_random_opening(Rng& rng, const std::vector<std::string>& book, usize random)
 {
-    auto board = Board();
+    auto board = book.empty() ? Board() : Board(book[rng.get() % book.size()]);
 
-    for (usize i = 0; i < MAX_OPENING; ++i) {
+    for (usize i = 0; i < random; ++i) {
         auto moves = move::gen::get_legal(board);
 
         if (moves.size() == 0) {
-            return get_random_opening(rng);
+            return get_random_opening(rng, book, random);
         }
 
         board.make(moves[rng.get() % moves.size()]);
     }
 
     if (move::gen::get_legal(board).size() == 0) {
-        return get_random_opening(rng);
+        return get_random_opening(rng, book, random);
     }
 
     return board;
 };
 
-inline i32 get_opening_score(const Board& board)
+inline i32 get_opening_score(const Board& board, game::Player& player, const Config& config)
 {
-    auto engine = search::Engine();
-    engine.set({ .hash = 8, .threads = 1 });
+    player.reset();
+
+    return game::search(player, board, config).score;
+};
 
-    return game::search(engine, board).score;
+// Every thread writes its own shard, they can be merged and shuffled afterwards with the merge command
+inline std::string get_shard_path(Output output, u64 id)
+{
+    return "out_" + std::to_string(id) + (output == Output::GAMES ? ".games" : ".bin");
 };
 
-inline void run(u64 thread_count)
+inline bool run(const Config& config)
 {
+    // Opening book
+    std::vector<std::string> book;
+
+    if (!config.book.empty()) {
+        auto fens = book::load(config.book);
+
+        if (!fens.has_value()) {
+            std::cout << "failed to read a position from " << config.book << std::endl;
+            return false;
+        }
+
+        book = fens.value();
+    }
+
+    config::print(config);
+
+    if (!book.empty()) {
+        std::cout << "book positions " << book.size() << std::endl;
+    }
+
     // Stats
     std::atomic<u64> positions = 0;
+    std::atomic<u64> games = 0;
     std::atomic<u64> win = 0;
     std::atomic<u64> loss = 0;
     std::atomic<u64> draw = 0;
+    std::atomic<u64> finished = 0;
+
+    const u64 time_start = timer::get_current();
+
+    // Games that are being played when a limit is reached are finished, so that no game is cut
+    auto is_over = [&] () {
+        return positions >= config.positions || (config.time > 0 && timer::get_current() - time_start >= config.time * 1000);
+    };
 
     // Threads
     std::vector<std::thread> threads;
-    std::mutex mtx;
 
-    for (u64 i = 0; i < thread_count; ++i) {
+    for (u64 i = 0; i < config.threads; ++i) {
         threads.emplace_back([&] (u64 id) {
             // Creates rng
             auto rng = Rng(id);
-            
+
+            // Packed positions or games, see format.h and the convert command for the text format
+            auto writer = format::Writer(get_shard_path(config.output, id));
+
             // Loops
-            u64 games = 0;
-            std::vector<std::string> lines;
+            u64 played = 0;
+            std::vector<format::Record> records;
+
+            auto replay = Board();
+            auto players = std::array<game::Player, 2>();
 
-            while (true) {
+            while (!is_over()) {
                 // Gets a random opening
-                auto board = get_random_opening(rng);
+                auto board = get_random_opening(rng, book, config.random);
 
                 // Removes super unbalanced openings
-                if (std::abs(get_opening_score(board)) >= MAX_OPENING_DELTA) {
+                if (std::abs(get_opening_score(board, players[0], config)) >= config.opening_delta) {
                     continue;
                 }
 
                 // Plays a game
-                auto game_result = game::run(board);
-                
+                auto game_result = game::run(board, players, config);
+
                 // Stores results
-                usize visited = 0;
+                if (config.output == Output::GAMES) {
+                    writer.write(game_result.game);
+                }
+                else {
+                    records.clear();
+                    format::get_records(game_result.game, replay, records, config.visit);
 
-                for (auto& p : game_result.positions) {
-                    if (visited >= MAX_VISIT) {
-                        break;
+                    for (const auto& record : records) {
+                        writer.write(record);
                     }
-
-                    std::string wdl_str =
-                        game_result.wdl == game::Wdl::WIN ? "1.0" :
-                        game_result.wdl == game::Wdl::LOSS ? "0.0" :
-                        "0.5";
-
-                    lines.push_back(p.fen + " | " + std::to_string(p.score) + " | " + wdl_str);
-
-                    visited += 1;
                 }
 
                 // Updates stats
-                positions += game_result.positions.size();
+                positions += std::min(game_result.kept, config.visit);
+                games += 1;
 
                 if (game_result.wdl == game::Wdl::WIN) {
                     win += 1;
@@ -130,40 +162,48 @@ inline void run(u64 thread_count)
                     draw += 1;
                 }
 
-                games += 1;
+                played += 1;
 
                 // Only save now and then
-                if (games % 100 == 0) {
-                    std::lock_guard<std::mutex> lk(mtx);
-
-                    std::ofstream o("out.txt", std::ios::out | std::ios::app);
-
-                    for (auto& line : lines) {
-                        o << line << std::endl;
-                    }
-
-                    lines.clear();
-                    o.close();
-
-                    // Reports
-                    f32 win_ratio = (f32(win.load()) + f32(draw.load()) / 2.0f) / f32(win.load() + draw.load() + loss.load());
-                    std::cout <<
-                        "\rprogress: " << (f64(positions) / f64(MAX_POSITION) * 100.0) <<
-                        " | positions: " << positions << "/" << MAX_POSITION <<
-                        " | win ratio: " << win_ratio << "                        ";
-                }
-
-                // Max positions reached
-                if (positions >= MAX_POSITION) {
-                    break;
+                if (played % 100 == 0) {
+                    writer.flush();
                 }
             }
+
+            finished += 1;
         }, i);
     }
 
+    // Reports from the counters, the workers never wait on it
+    auto report = [&] () {
+        const u64 time = std::max(timer::get_current() - time_start, u64(1));
+        const f32 win_ratio = (f32(win.load()) + f32(draw.load()) / 2.0f) / f32(std::max(games.load(), u64(1)));
+
+        std::cout <<
+            "\rprogress: " << (f64(positions) / f64(config.positions) * 100.0) <<
+            " | positions: " << positions << "/" << config.positions <<
+            " | positions/s: " << positions * 1000 / time <<
+            " | games: " << games <<
+            " | games/s: " << f64(games) * 1000.0 / f64(time) <<
+            " | win ratio: " << win_ratio <<
+            " | time: " << time / 1000 << " s" << "                        " << std::flush;
+    };
+
+    while (finished < config.threads)
+    {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        report();
+    }
+
     for (auto& t : threads) {
         t.join();
     }
+
+    report();
+
+    std::cout << std::endl;
+
+    return true;
 };
 
 };
\ No newline at end of file
@@ -0,0 +1,507 @@
+#pragma once
+
+#include <filesystem>
+#include "../engine/search.h"
+
+namespace datagen::format
+{
+
+namespace result
+{
+
+constexpr u8 LOSS = 0;
+constexpr u8 DRAW = 1;
+constexpr u8 WIN = 2;
+
+};
+
+// One position of a game in 32 bytes, the score and the result are white relative
+// Pieces are stored as 4 bit codes in the order of their squares in the occupancy
+struct Record
+{
+    u64 occupied;
+    u8 pieces[16];
+    u8 color_enpassant;
+    u8 halfmove;
+    u16 fullmove;
+    i16 score;
+    u8 result;
+    u8 castling;
+};
+
+static_assert(sizeof(Record) == 32);
+
+// Side to move in the high bit, the en passant square or 64 in the low bits
+constexpr u8 NO_ENPASSANT = 64;
+
+inline i16 get_score(i32 score)
+{
+    return i16(std::clamp(score, i32(-INT16_MAX), i32(INT16_MAX)));
+};
+
+inline Record pack(Board& board, i32 score, u8 result = result::DRAW)
+{
+    auto record = Record();
+
+    record.occupied = board.get_occupied();
+
+    u64 occupied = record.occupied;
+    usize i = 0;
+
+    while (occupied)
+    {
+        const auto square = bitboard::pop_lsb(occupied);
+
+        record.pieces[i / 2] |= u8(board.get_piece_at(square) << (4 * (i % 2)));
+        i += 1;
+    }
+
+    const i8 enpassant = board.get_enpassant_square();
+
+    record.color_enpassant = u8(board.get_color() << 7) | (enpassant == square::NONE ? NO_ENPASSANT : u8(enpassant));
+    record.halfmove = u8(std::min(board.get_halfmove_count(), i32(UINT8_MAX)));
+    record.fullmove = u16(std::min(board.get_fullmove_count(), i32(UINT16_MAX)));
+    record.score = format::get_score(score);
+    record.result = result;
+    record.castling = u8(board.get_castling_right());
+
+    return record;
+};
+
+// Calls the function with the square and the piece of every occupied square
+template <typename F>
+inline void for_each_piece(const Record& record, F&& function)
+{
+    u64 occupied = record.occupied;
+    usize i = 0;
+
+    while (occupied)
+    {
+        const auto square = bitboard::pop_lsb(occupied);
+
+        function(square, i8((record.pieces[i / 2] >> (4 * (i % 2))) & 0xF));
+        i += 1;
+    }
+};
+
+inline i8 get_color(const Record& record)
+{
+    return i8(record.color_enpassant >> 7);
+};
+
+inline std::string get_fen(const Record& record)
+{
+    i8 board[64];
+
+    std::fill(board, board + 64, i8(piece::NONE));
+
+    format::for_each_piece(record, [&] (i8 square, i8 piece) {
+        board[square] = piece;
+    });
+
+    std::string fen;
+
+    for (i8 rank = 7; rank >= 0; --rank) {
+        i32 space = 0;
+
+        for (i8 file = 0; file < 8; ++file) {
+            const i8 piece = board[square::create(file, rank)];
+
+            if (piece != piece::NONE) {
+                if (space) {
+                    fen += std::to_string(space);
+                    space = 0;
+                }
+
+                fen += piece::get_char(piece);
+            }
+            else {
+                space += 1;
+            }
+        }
+
+        if (space) {
+            fen += std::to_string(space);
+        }
+
+        if (rank > 0) {
+            fen += "/";
+        }
+    }
+
+    fen += " ";
+    fen += color::get_char(format::get_color(record));
+
+    if (record.castling == castling::NONE) {
+        fen += " -";
+    }
+    else {
+        fen += " ";
+        fen += (record.castling & castling::WHITE_SHORT) ? "K" : "";
+        fen += (record.castling & castling::WHITE_LONG) ? "Q" : "";
+        fen += (record.castling & castling::BLACK_SHORT) ? "k" : "";
+        fen += (record.castling & castling::BLACK_LONG) ? "q" : "";
+    }
+
+    const u8 enpassant = record.color_enpassant & 0x7F;
+
+    if (enpassant == NO_ENPASSANT) {
+        fen += " -";
+    }
+    else {
+        fen += " ";
+        fen += file::get_char(square::get_file(i8(enpassant)));
+        fen += rank::get_char(square::get_rank(i8(enpassant)));
+    }
+
+    fen += " ";
+    fen += std::to_string(record.halfmove);
+    fen += " ";
+    fen += std::to_string(record.fullmove);
+
+    return fen;
+};
+
+// Line of the text format, fen | score | wdl
+inline std::string get_text(const Record& record)
+{
+    const std::string wdl =
+        record.result == result::WIN ? "1.0" :
+        record.result == result::LOSS ? "0.0" :
+        "0.5";
+
+    return format::get_fen(record) + " | " + std::to_string(record.score) + " | " + wdl;
+};
+
+// Pieces of the record for the batch eval
+inline nnue::Position get_position(const Record& record)
+{
+    auto position = nnue::Position();
+
+    format::for_each_piece(record, [&] (i8 square, i8 piece) {
+        position.pieces[piece::get_type(piece)] |= 1ULL << square;
+        position.colors[piece::get_color(piece)] |= 1ULL << square;
+    });
+
+    position.color = format::get_color(record);
+
+    return position;
+};
+
+// One move of a game record and the white relative score of the position it was played from
+struct Move
+{
+    u16 move;
+    i16 score;
+};
+
+static_assert(sizeof(Move) == 4);
+
+// A whole game, the starting position followed by every move played, its result is the one of the start record
+// Consecutive positions only differ by one move, so replaying the moves costs 4 bytes per position instead of a record
+// On disk the moves are ended by a null move
+struct Game
+{
+    Record start;
+    std::vector<Move> moves;
+};
+
+// Positions worth training on, quiet ones where the side to move isn't in check
+inline bool is_kept(Board& board, u16 move)
+{
+    return !board.get_checkers() && board.is_quiet(move);
+};
+
+// Calls the function with every position of the game and the move played from it
+// The board is reused between games, creating a board allocates its history
+template <typename F>
+inline void replay(const Game& game, Board& board, F&& function)
+{
+    board.set_fen(format::get_fen(game.start));
+    board.update_masks();
+
+    for (const auto& move : game.moves) {
+        function(board, move.move, move.score);
+        board.make(move.move);
+    }
+
+    // Unwinds the history so that it doesn't grow across games
+    for (auto it = game.moves.rbegin(); it != game.moves.rend(); ++it) {
+        board.unmake(it->move);
+    }
+};
+
+// Appends the kept positions of the game as records, at most limit of them
+inline usize get_records(const Game& game, Board& board, std::vector<Record>& records, usize limit = SIZE_MAX)
+{
+    usize count = 0;
+
+    format::replay(game, board, [&] (Board& position, u16 move, i16 score) {
+        if (count < limit && format::is_kept(position, move)) {
+            records.push_back(format::pack(position, score, game.start.result));
+            count += 1;
+        }
+    });
+
+    return count;
+};
+
+// Appends records or games to a file, they are buffered and written in large blocks
+class Writer
+{
+private:
+    std::ofstream file;
+    std::vector<char> buffer;
+public:
+    static constexpr usize BUFFER = 1ULL << 21;
+public:
+    Writer(const std::string& path) : file(path, std::ios::binary | std::ios::app) {
+        this->buffer.reserve(BUFFER);
+    };
+
+    ~Writer() {
+        this->flush();
+    };
+public:
+    bool is_open() {
+        return this->file.is_open();
+    };
+
+    void write(const Record& record) {
+        this->append(&record, sizeof(Record));
+    };
+
+    void write(const Game& game) {
+        const auto end = Move { .move = move::NONE, .score = 0 };
+
+        this->append(&game.start, sizeof(Record));
+        this->append(game.moves.data(), game.moves.size() * sizeof(Move));
+        this->append(&end, sizeof(Move));
+    };
+
+    void append(const void* data, usize size) {
+        const auto bytes = static_cast<const char*>(data);
+
+        this->buffer.insert(this->buffer.end(), bytes, bytes + size);
+
+        if (this->buffer.size() >= BUFFER) {
+            this->flush();
+        }
+    };
+
+    void flush() {
+        this->file.write(this->buffer.data(), std::streamsize(this->buffer.size()));
+        this->file.flush();
+        this->buffer.clear();
+    };
+};
+
+// Reads records in blocks, a truncated record at the end of the file is ignored
+class Reader
+{
+private:
+    std::ifstream file;
+public:
+    Reader(const std::string& path) : file(path, std::ios::binary) {};
+public:
+    bool is_open() {
+        return this->file.is_open();
+    };
+
+    usize read(std::vector<Record>& records, usize count) {
+        records.resize(count);
+
+        this->file.read(reinterpret_cast<char*>(records.data()), std::streamsize(count * sizeof(Record)));
+
+        records.resize(usize(this->file.gcount()) / sizeof(Record));
+
+        return records.size();
+    };
+
+    // Reads the next game, returns false at the end of the file or on a truncated game
+    bool read(Game& game) {
+        game.moves.clear();
+
+        if (!this->file.read(reinterpret_cast<char*>(&game.start), sizeof(Record))) {
+            return false;
+        }
+
+        auto move = Move();
+
+        while (this->file.read(reinterpret_cast<char*>(&move), sizeof(Move)))
+        {
+            if (move.move == move::NONE) {
+                return true;
+            }
+
+            game.moves.push_back(move);
+        }
+
+        return false;
+    };
+};
+
+// Converts a binary file to the text format, returns the number of positions
+// Game files are replayed and only their kept positions are written, at most limit per game
+inline std::optional<u64> convert(const std::string& in, const std::string& out, bool games = false, usize limit = SIZE_MAX)
+{
+    auto reader = Reader(in);
+    auto output = std::ofstream(out);
+
+    if (!reader.is_open() || !output.is_open()) {
+        return {};
+    }
+
+    std::vector<Record> records;
+    u64 count = 0;
+
+    if (games) {
+        auto game = Game();
+        auto board = Board();
+
+        while (reader.read(game))
+        {
+            records.clear();
+            format::get_records(game, board, records, limit);
+
+            for (const auto& record : records) {
+                output << format::get_text(record) << "\n";
+            }
+
+            count += records.size();
+        }
+
+        return count;
+    }
+
+    while (reader.read(records, Writer::BUFFER / sizeof(Record)) > 0)
+    {
+        for (const auto& record : records) {
+            output << format::get_text(record) << "\n";
+        }
+
+        count += records.size();
+    }
+
+    return count;
+};
+
+// Records held in memory at once while shuffling, 256 MB
+constexpr usize SHUFFLE_BUCKET = 1ULL << 23;
+
+// Concatenates the shards of a datagen run into one file, returns the number of bytes written
+// Record files can be shuffled on the way, the records are first scattered into temporary buckets small enough to be shuffled in memory
+inline std::optional<u64> merge(const std::vector<std::string>& in, const std::string& out, bool shuffle, u64 seed = 1)
+{
+    u64 size = 0;
+
+    for (const auto& path : in) {
+        std::error_code error;
+        const auto file_size = std::filesystem::file_size(path, error);
+
+        if (error) {
+            return {};
+        }
+
+        // The output is removed before the inputs are read
+        if (std::filesystem::equivalent(path, out, error)) {
+            return {};
+        }
+
+        // Games have no fixed size, shuffling them as records would cut them apart
+        if (shuffle && (path.ends_with(".games") || file_size % sizeof(Record) != 0)) {
+            return {};
+        }
+
+        size += file_size;
+    }
+
+    std::filesystem::remove(out);
+
+    if (!shuffle) {
+        auto output = std::ofstream(out, std::ios::binary);
+
+        for (const auto& path : in) {
+            auto input = std::ifstream(path, std::ios::binary);
+
+            output << input.rdbuf();
+        }
+
+        output.flush();
+
+        if (!output.good()) {
+            return {};
+        }
+
+        return size;
+    }
+
+    auto get_random = [&] () {
+        seed ^= seed >> 12;
+        seed ^= seed << 25;
+        seed ^= seed >> 27;
+
+        return seed * 2685821657736338717ULL;
+    };
+
+    const usize bucket_count = usize(size / sizeof(Record) / SHUFFLE_BUCKET) + 1;
+
+    std::vector<std::string> buckets;
+
+    for (usize i = 0; i < bucket_count; ++i) {
+        buckets.push_back(out + ".bucket" + std::to_string(i));
+        std::filesystem::remove(buckets.back());
+    }
+
+    // Scatters
+    {
+        std::vector<std::unique_ptr<Writer>> writers;
+
+        for (const auto& bucket : buckets) {
+            writers.push_back(std::make_unique<Writer>(bucket));
+        }
+
+        std::vector<Record> records;
+
+        for (const auto& path : in) {
+            auto reader = Reader(path);
+
+            while (reader.read(records, Writer::BUFFER / sizeof(Record)) > 0)
+            {
+                for (const auto& record : records) {
+                    writers[get_random() % bucket_count]->write(record);
+                }
+            }
+        }
+    }
+
+    // Shuffles every bucket and appends it
+    auto writer = Writer(out);
+    u64 count = 0;
+
+    for (const auto& bucket : buckets) {
+        std::vector<Record> records;
+
+        auto reader = Reader(bucket);
+
+        reader.read(records, usize(std::filesystem::file_size(bucket)) / sizeof(Record));
+
+        for (usize i = records.size(); i > 1; --i) {
+            std::swap(records[i - 1], records[get_random() % i]);
+        }
+
+        for (const auto& record : records) {
+            writer.write(record);
+        }
+
+        count += records.size();
+
+        std::filesystem::remove(bucket);
+    }
+
+    writer.flush();
+
+    return count * sizeof(Record);
+};
+
+};
\ No newline at end of file
@@ -1,13 +1,11 @@
 #pragma once
 
-#include "../engine/search.h"
+#include "format.h"
+#include "config.h"
 
 namespace datagen::game
 {
 
-constexpr i32 MAX_DEPTH = 8;
-constexpr i32 MAX_SCORE = 2000;
-
 enum class Wdl
 {
     DRAW,
@@ -21,80 +19,148 @@ struct SearchResult
     u16 move = move::NONE;
 };
 
-struct Position
+// The game is recorded as its start and its moves, the result is filled in once the game is over
+struct Result
 {
-    std::string fen;
-    i32 score;
+    format::Game game;
+    usize kept = 0;
+    Wdl wdl;
 };
 
-struct Result
+// An engine and its search data, a datagen thread keeps them for all its games instead of allocating them for every game and move
+class Player
 {
-    std::vector<Position> positions;
-    Wdl wdl;
+public:
+    search::Engine engine;
+    std::unique_ptr<Data> data;
+public:
+    // The player searches on its own thread with its own data, so only the table is sized and the engine spawns no workers
+    Player() {
+        this->engine.table.init(8);
+        this->engine.clear_table();
+        this->data = std::make_unique<Data>(Board());
+    };
+public:
+    // Starts a new game cheaply, the table is invalidated by changing its salt and bumping its age instead of being zeroed
+    // History is decayed instead of cleared, since HS_DECAY doesn't decay it between moves by default
+    void reset() {
+        this->engine.table.invalidate();
+        this->data->history.decay(HISTORY_DECAY_GAME);
+    };
 };
 
-inline SearchResult search(search::Engine& engine, const Board& board)
+inline SearchResult search(Player& player, const Board& board, const Config& config)
 {
     auto result = SearchResult();
+    auto& engine = player.engine;
+    auto& data = *player.data;
 
     // Updates engine
     engine.table.update();
     engine.timer.clear();
     engine.running.test_and_set();
 
-    // Inits data
-    auto data = new Data(board);
+    // Inits data, history tables are kept from the previous move
+    data.board = board;
+    data.pv_index = 0;
+    data.nodes_search = 0;
+
+    if (tune::HS_DECAY < 1024) {
+        data.history.decay(tune::HS_DECAY);
+    }
+
+    data.clear();
+    data.roots.init(data, move::NONE);
+
+    // A node limited search deepens until it has used the soft limit and is cut at the hard one
+    engine.timer.limit_nodes = config.nodes ? config.nodes * NODES_HARD_RATIO : UINT64_MAX;
+
+    const i32 depth = config.nodes ? MAX_PLY - 1 : config.depth;
 
     // Search
-    for (i32 i = 1; i <= MAX_DEPTH; ++i) {
-        data->clear();
+    for (i32 i = 1; i <= depth; ++i) {
+        data.clear();
+        data.roots.prepare();
 
-        result.score = engine.aspiration_window(*data, i, result.score);
-        result.move = data->stack[0].pv[0];
-    }
+        const i32 score = engine.aspiration_window(data, i, result.score);
+
+        data.nodes_search += data.nodes;
+
+        // The result of a cut iteration isn't complete, the previous one is kept
+        if (!engine.running.test() && i > 1) {
+            break;
+        }
+
+        result.score = score;
+        result.move = data.roots[0].move;
 
-    // Clears data
-    delete data;
+        if (config.nodes && data.nodes_search >= config.nodes) {
+            break;
+        }
+    }
 
     return result;
 };
 
-inline Result run(Board& board)
+inline Result run(Board& board, std::array<Player, 2>& players, const Config& config)
 {
     auto result = Result();
 
-    // Inits engines
-    search::Engine engines[2] = { search::Engine(), search::Engine() };
+    result.game.start = format::pack(board, 0);
+
+    // Inits players
+    players[0].reset();
+    players[1].reset();
 
-    engines[0].set({ .hash = 8, .threads = 1 });
-    engines[1].set({ .hash = 8, .threads = 1 });
+    // Plies in a row that agree on the adjudication
+    i32 win_plies = 0;
+    i32 loss_plies = 0;
+    i32 draw_plies = 0;
 
     // Plays
     while (true)
     {
         // Search
-        auto search_result = search(engines[board.get_color()], board);
+        auto search_result = search(players[board.get_color()], board, config);
 
         // Updates score to white relative
         search_result.score = board.get_color() == color::WHITE ? search_result.score : -search_result.score;
 
-        // If the score is high enough, stop
-        if (std::abs(search_result.score) >= MAX_SCORE) {
-            result.wdl = search_result.score > 0 ? Wdl::WIN : Wdl::LOSS;
+        // If the score stays high enough, stop
+        win_plies = search_result.score >= config.win_score ? win_plies + 1 : 0;
+        loss_plies = search_result.score <= -config.win_score ? loss_plies + 1 : 0;
+
+        if (win_plies >= config.win_plies || loss_plies >= config.win_plies) {
+            result.wdl = win_plies > 0 ? Wdl::WIN : Wdl::LOSS;
+            break;
+        }
+
+        // If the score stays close to even late enough in the game, it's a draw
+        const bool is_even = i32(result.game.moves.size()) >= config.draw_ply && std::abs(search_result.score) <= config.draw_score;
+
+        draw_plies = is_even ? draw_plies + 1 : 0;
+
+        if (config.draw_plies > 0 && draw_plies >= config.draw_plies) {
+            result.wdl = Wdl::DRAW;
             break;
         }
 
-        // Adds position
-        if (!board.get_checkers() && board.is_quiet(search_result.move)) {
-            result.positions.push_back(Position {
-                .fen = board.get_fen(),
-                .score = search_result.score
-            });
+        // Adds move
+        if (format::is_kept(board, search_result.move)) {
+            result.kept += 1;
         }
 
+        result.game.moves.push_back({ .move = search_result.move, .score = format::get_score(search_result.score) });
+
         // Updates board
         board.make(search_result.move);
 
+        // Checks mate, the side to move has lost
+        if (move::gen::get_legal(board).size() == 0 && board.get_checkers()) {
+            result.wdl = board.get_color() == color::WHITE ? Wdl::LOSS : Wdl::WIN;
+            break;
+        }
+
         // Checks draw
         if (board.is_draw() || move::gen::get_legal(board).size() == 0) {
             result.wdl = Wdl::DRAW;
@@ -102,6 +168,11 @@ inline Result run(Board& board)
         }
     }
 
+    result.game.start.result =
+        result.wdl == Wdl::WIN ? format::result::WIN :
+        result.wdl == Wdl::LOSS ? format::result::LOSS :
+        format::result::DRAW;
+
     return result;
 };
 
@@ -4,6 +4,8 @@ Data::Data(const Board& board, u64 id)
 {
     this->board = board;
     this->id = id;
+    this->pv_index = 0;
+    this->nodes_search = 0;
     this->clear();
 };
 
@@ -11,11 +13,11 @@ void Data::clear()
 {
     this->ply = 0;
     this->stack.clear();
-    this->nnue = nnue::Net();
+    this->nnue.clear();
     this->nnue.refresh(this->board);
+    this->cache.update();
     this->nodes = 0;
     this->seldepth = 0;
-    this->counter = node::Counter();
 };
 
 void Data::make(const u16& move)
@@ -3,6 +3,7 @@
 #include "history.h"
 #include "stack.h"
 #include "node.h"
+#include "root.h"
 
 class Data
 {
@@ -13,12 +14,16 @@ public:
     i32 ply;
     stack::Data stack;
     nnue::Net nnue;
+    eval::Cache cache;
+public:
+    root::List roots;
+    usize pv_index;
 public:
     history::Table history {};
 public:
     u64 nodes;
+    u64 nodes_search;
     i32 seldepth;
-    node::Counter counter;
 public:
     Data(const Board& board, u64 id = 0);
 public:
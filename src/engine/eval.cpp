@@ -3,10 +3,92 @@
 namespace eval
 {
 
-i32 get(Board& board, nnue::Net& nnue)
+// Scores stored in empty entries, no net gives this output
+constexpr i32 CACHE_EMPTY = INT32_MIN;
+
+Cache::Cache()
+{
+    this->mask = 0;
+    this->generation = 0;
+    this->count_probe = 0;
+    this->count_hit = 0;
+};
+
+// The entry count is rounded down to a power of two, a size of zero disables the cache
+void Cache::init(u64 kb)
+{
+    const u64 count = kb * 1024 / sizeof(Entry);
+
+    this->entries = std::vector<Entry>(count > 0 ? std::bit_floor(count) : 0);
+    this->mask = this->entries.empty() ? 0 : this->entries.size() - 1;
+    this->clear();
+};
+
+void Cache::clear()
+{
+    for (auto& entry : this->entries) {
+        entry = Entry { .key = 0, .score = CACHE_EMPTY };
+    }
+
+    this->generation = nnue::generation;
+};
+
+// Scores of an older net are dropped
+void Cache::update()
+{
+    if (this->generation != nnue::generation) {
+        this->clear();
+    }
+
+    this->count_probe = 0;
+    this->count_hit = 0;
+};
+
+// The low bits of the hash pick the entry and the high bits are the key
+bool Cache::get(u64 hash, i32& score)
 {
-    // Gets score from nnue
-    i32 score = nnue.get_eval(board.get_color());
+    if (this->entries.empty()) {
+        return false;
+    }
+
+    const auto& entry = this->entries[hash & this->mask];
+
+    this->count_probe += 1;
+
+    if (entry.key != u32(hash >> 32) || entry.score == CACHE_EMPTY) {
+        return false;
+    }
+
+    this->count_hit += 1;
+
+    score = entry.score;
+
+    return true;
+};
+
+void Cache::set(u64 hash, i32 score)
+{
+    if (this->entries.empty()) {
+        return;
+    }
+
+    this->entries[hash & this->mask] = Entry { .key = u32(hash >> 32), .score = score };
+};
+
+i32 get(Board& board, nnue::Net& nnue, Cache& cache)
+{
+    // Gets score from the cache or from nnue, a hit leaves the accumulator update pending
+    i32 score = 0;
+
+    if (!cache.get(board.get_hash(), score)) {
+        score = nnue.get_eval(board);
+        cache.set(board.get_hash(), score);
+    }
+
+    // Nets with output buckets already account for the material
+    if (nnue::output_bucket > 1) {
+        return std::clamp(score, -score::MATE_FOUND + 1, score::MATE_FOUND - 1);
+    }
 
     // Scales score based on material
     i32 scale = 0;
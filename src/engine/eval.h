@@ -30,7 +30,34 @@ constexpr i32 SCALE_QUEEN = 10;
 constexpr i32 SCALE_MAX = 256;
 constexpr i32 SCALE_MIN = SCALE_MAX - SCALE_PAWN * 16 - SCALE_KNIGHT * 4 - SCALE_BISHOP * 4 - SCALE_ROOK * 4 - SCALE_QUEEN * 2;
 
-i32 get(Board& board, nnue::Net& nnue);
+// Raw network outputs of recently evaluated positions, direct mapped and overwritten on every store
+// Each thread has its own, so probing it needs no synchronization
+class Cache
+{
+private:
+    struct Entry
+    {
+        u32 key;
+        i32 score;
+    };
+private:
+    std::vector<Entry> entries;
+    u64 mask;
+    u64 generation;
+public:
+    u64 count_probe;
+    u64 count_hit;
+public:
+    Cache();
+public:
+    void init(u64 kb);
+    void clear();
+    void update();
+    bool get(u64 hash, i32& score);
+    void set(u64 hash, i32 score);
+};
+
+i32 get(Board& board, nnue::Net& nnue, Cache& cache);
 
 i32 get_adjusted(i32 eval, i32 correction, i32 halfmove);
 
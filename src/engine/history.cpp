@@ -144,6 +144,21 @@ void Table::update(Board& board, const u16& move, i16 bonus)
 namespace history
 {
 
+void Table::clear()
+{
+    std::memset((void*)this, 0, sizeof(Table));
+};
+
+void Table::decay(i32 factor)
+{
+    // Every table is a plain array of i16, so we scale them all at once
+    auto entries = reinterpret_cast<i16*>(this);
+
+    for (usize i = 0; i < sizeof(Table) / sizeof(i16); ++i) {
+        entries[i] = i16(i32(entries[i]) * factor / 1024);
+    }
+};
+
 i32 Table::get_correction(Board& board)
 {
     i32 correction = 0;
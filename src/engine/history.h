@@ -146,10 +146,15 @@ public:
     history::corr::Table corr_non_pawn[2] = {};
     history::corr::Table corr_minor = {};
     history::corr::Table corr_major = {};
+public:
+    void clear();
+    void decay(i32 factor);
 public:
     i32 get_correction(Board& board);
 public:
     void update_correction(Board& board, i16 bonus);
 };
 
+static_assert(sizeof(Table) % sizeof(i16) == 0);
+
 };
\ No newline at end of file
@@ -0,0 +1,467 @@
+#pragma once
+
+#include <type_traits>
+
+#include "../chess/chess.h"
+
+#if defined(__x86_64__)
+    #include <x86intrin.h>
+#endif
+
+// Simd kernels of the network, every instruction set gets its own version that is picked at runtime
+// All versions give the exact same results
+namespace nnue::kernel
+{
+
+// Adds and subtracts weight rows from the input accumulator, int8 rows are widened to 16 bits first
+template <usize SIZE, usize ADD, usize SUB, typename W>
+inline void edit_scalar(i16* output, const i16* input, const W* const* adds, const W* const* subs)
+{
+    for (usize i = 0; i < SIZE; ++i) {
+        i16 value = input[i];
+
+        for (usize k = 0; k < ADD; ++k) {
+            value += adds[k][i];
+        }
+
+        for (usize k = 0; k < SUB; ++k) {
+            value -= subs[k][i];
+        }
+
+        output[i] = value;
+    }
+};
+
+// Squared clipped relu dot product, the product of the clipped input and the weight is truncated to 16 bits like in the simd versions
+template <usize SIZE, i32 SCALE>
+inline i32 get_linear_scalar(const i16* inputs, const i16* weights)
+{
+    i32 value = 0;
+
+    for (usize i = 0; i < SIZE; ++i) {
+        const i16 crelu = std::clamp(inputs[i], i16(0), i16(SCALE));
+
+        value += i32(i16(crelu * weights[i])) * crelu;
+    }
+
+    return value;
+};
+
+// Output layer of a child computed straight from its parent accumulator, the child's accumulator is never written
+template <usize SIZE, i32 SCALE, usize ADD, usize SUB, typename W>
+inline i32 get_linear_edit_scalar(const i16* input, const W* const* adds, const W* const* subs, const i16* weights)
+{
+    i32 value = 0;
+
+    for (usize i = 0; i < SIZE; ++i) {
+        i16 accumulated = input[i];
+
+        for (usize k = 0; k < ADD; ++k) {
+            accumulated += adds[k][i];
+        }
+
+        for (usize k = 0; k < SUB; ++k) {
+            accumulated -= subs[k][i];
+        }
+
+        const i16 crelu = std::clamp(accumulated, i16(0), i16(SCALE));
+
+        value += i32(i16(crelu * weights[i])) * crelu;
+    }
+
+    return value;
+};
+
+#if defined(__x86_64__)
+    // Loads a row of weights as 16 bit lanes, int8 rows take half the memory and are sign extended
+    template <typename W>
+    __attribute__((target("sse4.1")))
+    inline __m128i load_sse41(const W* data)
+    {
+        if constexpr (std::is_same_v<W, i8>) {
+            return _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i*)data));
+        }
+        else {
+            return _mm_load_si128((const __m128i*)data);
+        }
+    };
+
+    template <typename W>
+    __attribute__((target("avx2")))
+    inline __m256i load_avx2(const W* data)
+    {
+        if constexpr (std::is_same_v<W, i8>) {
+            return _mm256_cvtepi8_epi16(_mm_load_si128((const __m128i*)data));
+        }
+        else {
+            return _mm256_load_si256((const __m256i*)data);
+        }
+    };
+
+    template <typename W>
+    __attribute__((target("avx512f,avx512bw")))
+    inline __m512i load_avx512(const W* data)
+    {
+        if constexpr (std::is_same_v<W, i8>) {
+            return _mm512_cvtepi8_epi16(_mm256_load_si256((const __m256i*)data));
+        }
+        else {
+            return _mm512_load_si512((const __m512i*)data);
+        }
+    };
+
+    template <usize SIZE, usize ADD, usize SUB, typename W>
+    __attribute__((target("sse4.1")))
+    inline void edit_sse41(i16* output, const i16* input, const W* const* adds, const W* const* subs)
+    {
+        for (usize i = 0; i < SIZE; i += 8) {
+            auto vec = _mm_load_si128((const __m128i*)&input[i]);
+
+            for (usize k = 0; k < ADD; ++k) {
+                vec = _mm_add_epi16(vec, kernel::load_sse41(&adds[k][i]));
+            }
+
+            for (usize k = 0; k < SUB; ++k) {
+                vec = _mm_sub_epi16(vec, kernel::load_sse41(&subs[k][i]));
+            }
+
+            _mm_store_si128((__m128i*)&output[i], vec);
+        }
+    };
+
+    template <usize SIZE, i32 SCALE>
+    __attribute__((target("sse4.1")))
+    inline i32 get_linear_sse41(const i16* inputs, const i16* weights)
+    {
+        auto vec = _mm_setzero_si128();
+
+        for (usize i = 0; i < SIZE; i += 8) {
+            // Calculates clipped relu
+            auto input = _mm_load_si128((const __m128i*)&inputs[i]);
+            auto crelu = _mm_min_epi16(_mm_max_epi16(input, _mm_setzero_si128()), _mm_set1_epi16(i16(SCALE)));
+
+            // Calculates screlu * weight by doing (crelu * weight) * crelu
+            auto weight = _mm_load_si128((const __m128i*)&weights[i]);
+            auto product = _mm_madd_epi16(_mm_mullo_epi16(crelu, weight), crelu);
+
+            vec = _mm_add_epi32(vec, product);
+        }
+
+        // Does horizontal addition twice
+        vec = _mm_hadd_epi32(vec, vec);
+        vec = _mm_hadd_epi32(vec, vec);
+
+        return _mm_cvtsi128_si32(vec);
+    };
+
+    template <usize SIZE, i32 SCALE, usize ADD, usize SUB, typename W>
+    __attribute__((target("sse4.1")))
+    inline i32 get_linear_edit_sse41(const i16* input, const W* const* adds, const W* const* subs, const i16* weights)
+    {
+        auto vec = _mm_setzero_si128();
+
+        for (usize i = 0; i < SIZE; i += 8) {
+            auto accumulated = _mm_load_si128((const __m128i*)&input[i]);
+
+            for (usize k = 0; k < ADD; ++k) {
+                accumulated = _mm_add_epi16(accumulated, kernel::load_sse41(&adds[k][i]));
+            }
+
+            for (usize k = 0; k < SUB; ++k) {
+                accumulated = _mm_sub_epi16(accumulated, kernel::load_sse41(&subs[k][i]));
+            }
+
+            auto crelu = _mm_min_epi16(_mm_max_epi16(accumulated, _mm_setzero_si128()), _mm_set1_epi16(i16(SCALE)));
+
+            auto weight = _mm_load_si128((const __m128i*)&weights[i]);
+            auto product = _mm_madd_epi16(_mm_mullo_epi16(crelu, weight), crelu);
+
+            vec = _mm_add_epi32(vec, product);
+        }
+
+        vec = _mm_hadd_epi32(vec, vec);
+        vec = _mm_hadd_epi32(vec, vec);
+
+        return _mm_cvtsi128_si32(vec);
+    };
+
+    template <usize SIZE, usize ADD, usize SUB, typename W>
+    __attribute__((target("avx2")))
+    inline void edit_avx2(i16* output, const i16* input, const W* const* adds, const W* const* subs)
+    {
+        for (usize i = 0; i < SIZE; i += 16) {
+            auto vec = _mm256_load_si256((const __m256i*)&input[i]);
+
+            for (usize k = 0; k < ADD; ++k) {
+                vec = _mm256_add_epi16(vec, kernel::load_avx2(&adds[k][i]));
+            }
+
+            for (usize k = 0; k < SUB; ++k) {
+                vec = _mm256_sub_epi16(vec, kernel::load_avx2(&subs[k][i]));
+            }
+
+            _mm256_store_si256((__m256i*)&output[i], vec);
+        }
+    };
+
+    // Adds the 2 128-bit lanes, then does horizontal addition twice
+    __attribute__((target("avx2")))
+    inline i32 sum_avx2(__m256i vec)
+    {
+        auto sum = _mm_add_epi32(
+            _mm256_extracti128_si256(vec, 0),
+            _mm256_extracti128_si256(vec, 1)
+        );
+
+        sum = _mm_hadd_epi32(sum, sum);
+        sum = _mm_hadd_epi32(sum, sum);
+
+        return _mm_cvtsi128_si32(sum);
+    };
+
+    template <usize SIZE, i32 SCALE>
+    __attribute__((target("avx2")))
+    inline i32 get_linear_avx2(const i16* inputs, const i16* weights)
+    {
+        auto vec = _mm256_setzero_si256();
+
+        for (usize i = 0; i < SIZE; i += 16) {
+            // Calculates clipped relu
+            auto input = _mm256_load_si256((const __m256i*)&inputs[i]);
+            auto crelu = _mm256_min_epi16(_mm256_max_epi16(input, _mm256_setzero_si256()), _mm256_set1_epi16(i16(SCALE)));
+
+            // Calculates screlu * weight by doing (crelu * weight) * crelu
+            auto weight = _mm256_load_si256((const __m256i*)&weights[i]);
+            auto product = _mm256_madd_epi16(_mm256_mullo_epi16(crelu, weight), crelu);
+
+            vec = _mm256_add_epi32(vec, product);
+        }
+
+        return kernel::sum_avx2(vec);
+    };
+
+    template <usize SIZE, i32 SCALE, usize ADD, usize SUB, typename W>
+    __attribute__((target("avx2")))
+    inline i32 get_linear_edit_avx2(const i16* input, const W* const* adds, const W* const* subs, const i16* weights)
+    {
+        auto vec = _mm256_setzero_si256();
+
+        for (usize i = 0; i < SIZE; i += 16) {
+            auto accumulated = _mm256_load_si256((const __m256i*)&input[i]);
+
+            for (usize k = 0; k < ADD; ++k) {
+                accumulated = _mm256_add_epi16(accumulated, kernel::load_avx2(&adds[k][i]));
+            }
+
+            for (usize k = 0; k < SUB; ++k) {
+                accumulated = _mm256_sub_epi16(accumulated, kernel::load_avx2(&subs[k][i]));
+            }
+
+            auto crelu = _mm256_min_epi16(_mm256_max_epi16(accumulated, _mm256_setzero_si256()), _mm256_set1_epi16(i16(SCALE)));
+
+            auto weight = _mm256_load_si256((const __m256i*)&weights[i]);
+            auto product = _mm256_madd_epi16(_mm256_mullo_epi16(crelu, weight), crelu);
+
+            vec = _mm256_add_epi32(vec, product);
+        }
+
+        return kernel::sum_avx2(vec);
+    };
+
+    template <usize SIZE, usize ADD, usize SUB, typename W>
+    __attribute__((target("avx512f,avx512bw")))
+    inline void edit_avx512(i16* output, const i16* input, const W* const* adds, const W* const* subs)
+    {
+        static_assert(SIZE % 32 == 0);
+
+        for (usize i = 0; i < SIZE; i += 32) {
+            auto vec = _mm512_load_si512((const __m512i*)&input[i]);
+
+            for (usize k = 0; k < ADD; ++k) {
+                vec = _mm512_add_epi16(vec, kernel::load_avx512(&adds[k][i]));
+            }
+
+            for (usize k = 0; k < SUB; ++k) {
+                vec = _mm512_sub_epi16(vec, kernel::load_avx512(&subs[k][i]));
+            }
+
+            _mm512_store_si512((__m512i*)&output[i], vec);
+        }
+    };
+
+    // Adds the 2 256-bit halves by hand, gcc 12 warns about an uninitialized value inside _mm512_reduce_add_epi32
+    __attribute__((target("avx512f")))
+    inline i32 sum_avx512(__m512i vec)
+    {
+        return kernel::sum_avx2(_mm256_add_epi32(
+            _mm512_castsi512_si256(vec),
+            _mm512_extracti64x4_epi64(vec, 1)
+        ));
+    };
+
+    template <usize SIZE, i32 SCALE>
+    __attribute__((target("avx512f,avx512bw")))
+    inline i32 get_linear_avx512(const i16* inputs, const i16* weights)
+    {
+        static_assert(SIZE % 32 == 0);
+
+        auto vec = _mm512_setzero_si512();
+
+        for (usize i = 0; i < SIZE; i += 32) {
+            // Calculates clipped relu
+            auto input = _mm512_load_si512((const __m512i*)&inputs[i]);
+            auto crelu = _mm512_min_epi16(_mm512_max_epi16(input, _mm512_setzero_si512()), _mm512_set1_epi16(i16(SCALE)));
+
+            // Calculates screlu * weight by doing (crelu * weight) * crelu
+            auto weight = _mm512_load_si512((const __m512i*)&weights[i]);
+            auto product = _mm512_madd_epi16(_mm512_mullo_epi16(crelu, weight), crelu);
+
+            vec = _mm512_add_epi32(vec, product);
+        }
+
+        return kernel::sum_avx512(vec);
+    };
+
+    template <usize SIZE, i32 SCALE, usize ADD, usize SUB, typename W>
+    __attribute__((target("avx512f,avx512bw")))
+    inline i32 get_linear_edit_avx512(const i16* input, const W* const* adds, const W* const* subs, const i16* weights)
+    {
+        static_assert(SIZE % 32 == 0);
+
+        auto vec = _mm512_setzero_si512();
+
+        for (usize i = 0; i < SIZE; i += 32) {
+            auto accumulated = _mm512_load_si512((const __m512i*)&input[i]);
+
+            for (usize k = 0; k < ADD; ++k) {
+                accumulated = _mm512_add_epi16(accumulated, kernel::load_avx512(&adds[k][i]));
+            }
+
+            for (usize k = 0; k < SUB; ++k) {
+                accumulated = _mm512_sub_epi16(accumulated, kernel::load_avx512(&subs[k][i]));
+            }
+
+            auto crelu = _mm512_min_epi16(_mm512_max_epi16(accumulated, _mm512_setzero_si512()), _mm512_set1_epi16(i16(SCALE)));
+
+            auto weight = _mm512_load_si512((const __m512i*)&weights[i]);
+            auto product = _mm512_madd_epi16(_mm512_mullo_epi16(crelu, weight), crelu);
+
+            vec = _mm512_add_epi32(vec, product);
+        }
+
+        return kernel::sum_avx512(vec);
+    };
+
+    // Vnni fuses the multiply add and the accumulation into one instruction, it wraps around like the separate ones
+    template <usize SIZE, i32 SCALE>
+    __attribute__((target("avx512f,avx512bw,avx512vnni")))
+    inline i32 get_linear_vnni(const i16* inputs, const i16* weights)
+    {
+        static_assert(SIZE % 32 == 0);
+
+        auto vec = _mm512_setzero_si512();
+
+        for (usize i = 0; i < SIZE; i += 32) {
+            // Calculates clipped relu
+            auto input = _mm512_load_si512((const __m512i*)&inputs[i]);
+            auto crelu = _mm512_min_epi16(_mm512_max_epi16(input, _mm512_setzero_si512()), _mm512_set1_epi16(i16(SCALE)));
+
+            // Calculates screlu * weight by doing (crelu * weight) * crelu
+            auto weight = _mm512_load_si512((const __m512i*)&weights[i]);
+
+            vec = _mm512_dpwssd_epi32(vec, _mm512_mullo_epi16(crelu, weight), crelu);
+        }
+
+        return kernel::sum_avx512(vec);
+    };
+
+    template <usize SIZE, i32 SCALE, usize ADD, usize SUB, typename W>
+    __attribute__((target("avx512f,avx512bw,avx512vnni")))
+    inline i32 get_linear_edit_vnni(const i16* input, const W* const* adds, const W* const* subs, const i16* weights)
+    {
+        static_assert(SIZE % 32 == 0);
+
+        auto vec = _mm512_setzero_si512();
+
+        for (usize i = 0; i < SIZE; i += 32) {
+            auto accumulated = _mm512_load_si512((const __m512i*)&input[i]);
+
+            for (usize k = 0; k < ADD; ++k) {
+                accumulated = _mm512_add_epi16(accumulated, kernel::load_avx512(&adds[k][i]));
+            }
+
+            for (usize k = 0; k < SUB; ++k) {
+                accumulated = _mm512_sub_epi16(accumulated, kernel::load_avx512(&subs[k][i]));
+            }
+
+            auto crelu = _mm512_min_epi16(_mm512_max_epi16(accumulated, _mm512_setzero_si512()), _mm512_set1_epi16(i16(SCALE)));
+
+            auto weight = _mm512_load_si512((const __m512i*)&weights[i]);
+
+            vec = _mm512_dpwssd_epi32(vec, _mm512_mullo_epi16(crelu, weight), crelu);
+        }
+
+        return kernel::sum_avx512(vec);
+    };
+#endif
+
+template <usize SIZE, usize ADD, usize SUB, typename W>
+inline void edit(i16* output, const i16* input, const W* const* adds, const W* const* subs)
+{
+    switch (cpu::arch)
+    {
+#if defined(__x86_64__)
+    case cpu::Arch::VNNI:
+    case cpu::Arch::AVX512:
+        return kernel::edit_avx512<SIZE, ADD, SUB>(output, input, adds, subs);
+    case cpu::Arch::AVX2:
+        return kernel::edit_avx2<SIZE, ADD, SUB>(output, input, adds, subs);
+    case cpu::Arch::SSE41:
+        return kernel::edit_sse41<SIZE, ADD, SUB>(output, input, adds, subs);
+#endif
+    default:
+        return kernel::edit_scalar<SIZE, ADD, SUB>(output, input, adds, subs);
+    }
+};
+
+template <usize SIZE, i32 SCALE>
+inline i32 get_linear(const i16* inputs, const i16* weights)
+{
+    switch (cpu::arch)
+    {
+#if defined(__x86_64__)
+    case cpu::Arch::VNNI:
+        return kernel::get_linear_vnni<SIZE, SCALE>(inputs, weights);
+    case cpu::Arch::AVX512:
+        return kernel::get_linear_avx512<SIZE, SCALE>(inputs, weights);
+    case cpu::Arch::AVX2:
+        return kernel::get_linear_avx2<SIZE, SCALE>(inputs, weights);
+    case cpu::Arch::SSE41:
+        return kernel::get_linear_sse41<SIZE, SCALE>(inputs, weights);
+#endif
+    default:
+        return kernel::get_linear_scalar<SIZE, SCALE>(inputs, weights);
+    }
+};
+
+template <usize SIZE, i32 SCALE, usize ADD, usize SUB, typename W>
+inline i32 get_linear_edit(const i16* input, const W* const* adds, const W* const* subs, const i16* weights)
+{
+    switch (cpu::arch)
+    {
+#if defined(__x86_64__)
+    case cpu::Arch::VNNI:
+        return kernel::get_linear_edit_vnni<SIZE, SCALE, ADD, SUB>(input, adds, subs, weights);
+    case cpu::Arch::AVX512:
+        return kernel::get_linear_edit_avx512<SIZE, SCALE, ADD, SUB>(input, adds, subs, weights);
+    case cpu::Arch::AVX2:
+        return kernel::get_linear_edit_avx2<SIZE, SCALE, ADD, SUB>(input, adds, subs, weights);
+    case cpu::Arch::SSE41:
+        return kernel::get_linear_edit_sse41<SIZE, SCALE, ADD, SUB>(input, adds, subs, weights);
+#endif
+    default:
+        return kernel::get_linear_edit_scalar<SIZE, SCALE, ADD, SUB>(input, adds, subs, weights);
+    }
+};
+
+};
@@ -9,74 +9,189 @@ namespace nnue
 
 INCBIN(nnue_raw, NNUE);
 
-usize Feature::get_index(i8 color)
+// Memory of the loaded parameters, either a copy or a mapped net file
+static void* storage = nullptr;
+static file::Mapping mapping = file::Mapping();
+
+// Input bucket and mirrored half of the perspective's king, each pair has its own cache entry
+template <typename L>
+inline usize get_cache_index(i8 color, i8 king)
+{
+    usize index = 0;
+
+    if constexpr (L::INPUT_BUCKET > 1) {
+        index = buckets[square::get_relative(king, color)] * (L::MIRROR ? 2 : 1);
+    }
+
+    if constexpr (L::MIRROR) {
+        index += square::get_file(king) >= 4;
+    }
+
+    return index;
+};
+
+// Material output bucket
+template <typename L>
+inline usize get_output_bucket(u64 occupied)
+{
+    if constexpr (L::OUTPUT_BUCKET == 1) {
+        return 0;
+    }
+    else {
+        constexpr usize DIVISOR = (32 + L::OUTPUT_BUCKET - 1) / L::OUTPUT_BUCKET;
+
+        return std::min(usize(bitboard::get_count(occupied) - 2) / DIVISOR, L::OUTPUT_BUCKET - 1);
+    }
+};
+
+template <typename L>
+usize Feature::get_index(i8 color, i8 king)
 {
     const usize index_color = piece::get_color(this->piece) != color;
     const usize index_piece = piece::get_type(this->piece);
-    const usize index_square = square::get_relative(this->square, color);
 
-    return usize(384) * index_color + usize(64) * index_piece + index_square;
+    i8 square = square::get_relative(this->square, color);
+    usize bucket = 0;
+
+    // Mirrored nets always see their king on the queen side
+    if constexpr (L::MIRROR) {
+        if (square::get_file(king) >= 4) {
+            square ^= 7;
+        }
+    }
+
+    if constexpr (L::INPUT_BUCKET > 1) {
+        bucket = buckets[square::get_relative(king, color)];
+    }
+
+    return size::INPUT * bucket + usize(384) * index_color + usize(64) * index_piece + square;
+};
+
+template <typename L>
+Cache<L>::Cache()
+{
+    this->clear();
 };
 
-void Accumulator::clear()
+template <typename L>
+void Cache<L>::clear()
 {
+    // Entries start as an empty board
     for (i8 color = 0; color < 2; ++color) {
-        for (usize i = 0; i < size::HIDDEN; ++i) {
-            this->data[color][i] = PARAMS.in_biases[i];
+        for (usize i = 0; i < L::CACHE; ++i) {
+            auto& entry = this->entries[color][i];
+
+            std::memcpy(entry.data, params<L>->in_biases, sizeof(entry.data));
+            std::memset(entry.pieces, 0, sizeof(entry.pieces));
+            std::memset(entry.colors, 0, sizeof(entry.colors));
         }
     }
 };
 
-void Accumulator::refresh(Board& board)
+template <typename L>
+void Accumulator<L>::clear(i8 color)
 {
-    this->clear();
+    std::memcpy(this->data[color], params<L>->in_biases, sizeof(this->data[color]));
+};
 
-    auto occupied = board.get_occupied();
+template <typename L>
+void Accumulator<L>::refresh(i8 color)
+{
+    this->clear(color);
 
-    while (occupied)
-    {
-        const auto square = bitboard::pop_lsb(occupied);
-        const auto piece = board.get_piece_at(square);
+    const auto& weights = params<L>->in_weights;
+
+    for (i8 piece_color = 0; piece_color < 2; ++piece_color) {
+        for (i8 type = 0; type < 6; ++type) {
+            u64 occupied = this->pieces[type] & this->colors[piece_color];
 
-        const auto index_white = Feature { .piece = piece, .square = square }.get_index(color::WHITE);
-        const auto index_black = Feature { .piece = piece, .square = square }.get_index(color::BLACK);
+            while (occupied)
+            {
+                const auto square = bitboard::pop_lsb(occupied);
+                const auto index = Feature { .piece = piece::create(type, piece_color), .square = square }.template get_index<L>(color, this->kings[color]);
 
-        for (usize i = 0; i < size::HIDDEN; ++i) {
-            this->data[color::WHITE][i] += PARAMS.in_weights[index_white][i];
-            this->data[color::BLACK][i] += PARAMS.in_weights[index_black][i];
+                for (usize i = 0; i < L::HIDDEN; ++i) {
+                    this->data[color][i] += weights[index][i];
+                }
+            }
         }
     }
 };
 
-void Accumulator::make(const Accumulator& parent, i8 color)
+template <typename L>
+void Accumulator<L>::refresh(Cache<L>& cache, i8 color)
+{
+    auto& entry = cache.entries[color][nnue::get_cache_index<L>(color, this->kings[color])];
+
+    const auto& weights = params<L>->in_weights;
+
+    // Only the pieces that changed since this entry was last used are updated
+    for (i8 piece_color = 0; piece_color < 2; ++piece_color) {
+        for (i8 type = 0; type < 6; ++type) {
+            const u64 old = entry.pieces[type] & entry.colors[piece_color];
+            const u64 now = this->pieces[type] & this->colors[piece_color];
+
+            u64 adds = now & ~old;
+            u64 subs = old & ~now;
+
+            while (adds)
+            {
+                const auto square = bitboard::pop_lsb(adds);
+                const auto index = Feature { .piece = piece::create(type, piece_color), .square = square }.template get_index<L>(color, this->kings[color]);
+
+                for (usize i = 0; i < L::HIDDEN; ++i) {
+                    entry.data[i] += weights[index][i];
+                }
+            }
+
+            while (subs)
+            {
+                const auto square = bitboard::pop_lsb(subs);
+                const auto index = Feature { .piece = piece::create(type, piece_color), .square = square }.template get_index<L>(color, this->kings[color]);
+
+                for (usize i = 0; i < L::HIDDEN; ++i) {
+                    entry.data[i] -= weights[index][i];
+                }
+            }
+        }
+    }
+
+    std::memcpy(entry.pieces, this->pieces, sizeof(entry.pieces));
+    std::memcpy(entry.colors, this->colors, sizeof(entry.colors));
+    std::memcpy(this->data[color], entry.data, sizeof(entry.data));
+};
+
+template <typename L>
+void Accumulator<L>::make(const Accumulator& parent, i8 color)
 {
     const auto adds = this->update.adds.size();
     const auto subs = this->update.subs.size();
+    const auto king = this->kings[color];
 
     if (adds == 2 && subs == 2) {
         this->edit_add2_sub2(
             parent,
-            this->update.adds[0].get_index(color),
-            this->update.adds[1].get_index(color),
-            this->update.subs[0].get_index(color),
-            this->update.subs[1].get_index(color),
+            this->update.adds[0].template get_index<L>(color, king),
+            this->update.adds[1].template get_index<L>(color, king),
+            this->update.subs[0].template get_index<L>(color, king),
+            this->update.subs[1].template get_index<L>(color, king),
             color
         );
     }
     else if (adds == 1 && subs == 2) {
         this->edit_add1_sub2(
             parent,
-            this->update.adds[0].get_index(color),
-            this->update.subs[0].get_index(color),
-            this->update.subs[1].get_index(color),
+            this->update.adds[0].template get_index<L>(color, king),
+            this->update.subs[0].template get_index<L>(color, king),
+            this->update.subs[1].template get_index<L>(color, king),
             color
         );
     }
     else if (adds == 1 && subs == 1) {
         this->edit_add1_sub1(
             parent,
-            this->update.adds[0].get_index(color),
-            this->update.subs[0].get_index(color),
+            this->update.adds[0].template get_index<L>(color, king),
+            this->update.subs[0].template get_index<L>(color, king),
             color
         );
     }
@@ -85,124 +200,167 @@ void Accumulator::make(const Accumulator& parent, i8 color)
     }
 };
 
-void Accumulator::edit_add1_sub1(const Accumulator& parent, usize add1, usize sub1, i8 color)
+template <typename L>
+i32 Accumulator<L>::get_linear(const Accumulator& parent, i8 color, const i16* weights)
 {
-    const auto vec_add1 = PARAMS.in_weights[add1];
-    const auto vec_sub1 = PARAMS.in_weights[sub1];
+    const typename L::Weight* adds[2] = {};
+    const typename L::Weight* subs[2] = {};
 
-    #ifdef __AVX2__
-        for (usize i = 0; i < size::HIDDEN; i += 16) {
-            auto vec = _mm256_load_si256((const __m256i*)&parent.data[color][i]);
+    const auto king = this->kings[color];
 
-            vec = _mm256_add_epi16(vec, _mm256_load_si256((const __m256i*)&vec_add1[i]));
-            vec = _mm256_sub_epi16(vec, _mm256_load_si256((const __m256i*)&vec_sub1[i]));
+    for (usize k = 0; k < this->update.adds.size(); ++k) {
+        adds[k] = params<L>->in_weights[this->update.adds[k].template get_index<L>(color, king)];
+    }
 
-            _mm256_store_si256((__m256i*)&this->data[color][i], vec);
-        }
-    #else
-        for (usize i = 0; i < size::HIDDEN; ++i) {
-            this->data[color][i] = parent.data[color][i] + vec_add1[i] - vec_sub1[i];
-        }
-    #endif
+    for (usize k = 0; k < this->update.subs.size(); ++k) {
+        subs[k] = params<L>->in_weights[this->update.subs[k].template get_index<L>(color, king)];
+    }
+
+    const auto count_adds = this->update.adds.size();
+    const auto count_subs = this->update.subs.size();
+
+    if (count_adds == 2 && count_subs == 2) {
+        return kernel::get_linear_edit<L::HIDDEN, scale::L0, 2, 2>(parent.data[color], adds, subs, weights);
+    }
+    else if (count_adds == 1 && count_subs == 2) {
+        return kernel::get_linear_edit<L::HIDDEN, scale::L0, 1, 2>(parent.data[color], adds, subs, weights);
+    }
+    else {
+        assert(count_adds == 1 && count_subs == 1);
+
+        return kernel::get_linear_edit<L::HIDDEN, scale::L0, 1, 1>(parent.data[color], adds, subs, weights);
+    }
 };
 
-void Accumulator::edit_add1_sub2(const Accumulator& parent, usize add1, usize sub1, usize sub2, i8 color)
+template <typename L>
+void Accumulator<L>::edit_add1_sub1(const Accumulator& parent, usize add1, usize sub1, i8 color)
 {
-    const auto vec_add1 = PARAMS.in_weights[add1];
-    const auto vec_sub1 = PARAMS.in_weights[sub1];
-    const auto vec_sub2 = PARAMS.in_weights[sub2];
+    const auto& weights = params<L>->in_weights;
 
-    #ifdef __AVX2__
-        for (usize i = 0; i < size::HIDDEN; i += 16) {
-            auto vec = _mm256_load_si256((const __m256i*)&parent.data[color][i]);
+    const typename L::Weight* adds[] = { weights[add1] };
+    const typename L::Weight* subs[] = { weights[sub1] };
 
-            vec = _mm256_add_epi16(vec, _mm256_load_si256((const __m256i*)&vec_add1[i]));
-            vec = _mm256_sub_epi16(vec, _mm256_load_si256((const __m256i*)&vec_sub1[i]));
-            vec = _mm256_sub_epi16(vec, _mm256_load_si256((const __m256i*)&vec_sub2[i]));
+    kernel::edit<L::HIDDEN, 1, 1>(this->data[color], parent.data[color], adds, subs);
+};
 
-            _mm256_store_si256((__m256i*)&this->data[color][i], vec);
-        }
-    #else
-        for (usize i = 0; i < size::HIDDEN; ++i) {
-            this->data[color][i] = parent.data[color][i] + vec_add1[i] - vec_sub1[i] - vec_sub2[i];
-        }
-    #endif
+template <typename L>
+void Accumulator<L>::edit_add1_sub2(const Accumulator& parent, usize add1, usize sub1, usize sub2, i8 color)
+{
+    const auto& weights = params<L>->in_weights;
+
+    const typename L::Weight* adds[] = { weights[add1] };
+    const typename L::Weight* subs[] = { weights[sub1], weights[sub2] };
+
+    kernel::edit<L::HIDDEN, 1, 2>(this->data[color], parent.data[color], adds, subs);
 };
 
-void Accumulator::edit_add2_sub2(const Accumulator& parent, usize add1, usize add2, usize sub1, usize sub2, i8 color)
+template <typename L>
+void Accumulator<L>::edit_add2_sub2(const Accumulator& parent, usize add1, usize add2, usize sub1, usize sub2, i8 color)
 {
-    const auto vec_add1 = PARAMS.in_weights[add1];
-    const auto vec_add2 = PARAMS.in_weights[add2];
-    const auto vec_sub1 = PARAMS.in_weights[sub1];
-    const auto vec_sub2 = PARAMS.in_weights[sub2];
+    const auto& weights = params<L>->in_weights;
 
-    #ifdef __AVX2__
-        for (usize i = 0; i < size::HIDDEN; i += 16) {
-            auto vec = _mm256_load_si256((const __m256i*)&parent.data[color][i]);
+    const typename L::Weight* adds[] = { weights[add1], weights[add2] };
+    const typename L::Weight* subs[] = { weights[sub1], weights[sub2] };
 
-            vec = _mm256_add_epi16(vec, _mm256_load_si256((const __m256i*)&vec_add1[i]));
-            vec = _mm256_add_epi16(vec, _mm256_load_si256((const __m256i*)&vec_add2[i]));
-            vec = _mm256_sub_epi16(vec, _mm256_load_si256((const __m256i*)&vec_sub1[i]));
-            vec = _mm256_sub_epi16(vec, _mm256_load_si256((const __m256i*)&vec_sub2[i]));
+    kernel::edit<L::HIDDEN, 2, 2>(this->data[color], parent.data[color], adds, subs);
+};
 
-            _mm256_store_si256((__m256i*)&this->data[color][i], vec);
-        }
-    #else
-        for (usize i = 0; i < size::HIDDEN; ++i) {
-            this->data[color][i] = parent.data[color][i] + vec_add1[i] + vec_add2[i] - vec_sub1[i] - vec_sub2[i];
-        }
-    #endif
+template <typename L>
+Network<L>::Network()
+{
+    this->clear();
 };
 
-Net::Net()
+template <typename L>
+void Network<L>::clear()
 {
     this->index = 0;
+    this->count_update = 0;
+    this->count_skip = 0;
+    this->count_fused = 0;
 };
 
-i32 Net::get_eval(i8 color)
+template <typename L>
+template <bool FUSED>
+i32 Network<L>::get_eval(Board& board)
 {
+    const auto color = board.get_color();
+    const auto bucket = nnue::get_output_bucket<L>(board.get_occupied());
+    const auto& weights = params<L>->out_weights[bucket];
+
+    auto& accumulator = this->stack[this->index];
+
     i32 score = 0;
 
-    #ifdef __AVX2__
-        // Adds the stm vec and nstm vec
-        auto vec = _mm256_add_epi32(
-            nnue::get_linear<size::HIDDEN, scale::L0>(this->stack[this->index].data[color], PARAMS.out_weights[0]),
-            nnue::get_linear<size::HIDDEN, scale::L0>(this->stack[this->index].data[!color], PARAMS.out_weights[1])
-        );
+    for (i8 side = 0; side < 2; ++side) {
+        const i8 perspective = side == 0 ? color : !color;
 
-        // Adds the 2 128-bit lanes
-        auto sum = _mm_add_epi32(
-            _mm256_extracti128_si256(vec, 0),
-            _mm256_extracti128_si256(vec, 1)
-        );
+        // Most qsearch leaves are only evaluated, so the last update is fused into the output layer
+        // The accumulator stays pending and is only written if a child of this node needs it
+        if (FUSED && !accumulator.is_accurate[perspective] && !accumulator.is_refresh[perspective]) {
+            this->apply(this->index - 1, perspective);
 
-        // Does horizontal addition twice
-        sum = _mm_hadd_epi32(sum, sum);
-        sum = _mm_hadd_epi32(sum, sum);
+            score += accumulator.get_linear(this->stack[this->index - 1], perspective, weights[side]);
 
-        // Extracts the result
-        score = _mm_cvtsi128_si32(sum);
-    #else
-        score += nnue::get_linear<size::HIDDEN, scale::L0>(this->stack[this->index].data[color], PARAMS.out_weights[0]);
-        score += nnue::get_linear<size::HIDDEN, scale::L0>(this->stack[this->index].data[!color], PARAMS.out_weights[1]);
-    #endif
+            accumulator.is_fused = true;
+        }
+        else {
+            this->apply(this->index, perspective);
 
-    return (score / scale::L0 + PARAMS.out_bias) * scale::EVAL / (scale::L0 * scale::L1);
+            score += kernel::get_linear<L::HIDDEN, scale::L0>(accumulator.data[perspective], weights[side]);
+        }
+    }
+
+    return (score / scale::L0 + params<L>->out_biases[bucket]) * scale::EVAL / (scale::L0 * scale::L1);
 };
 
-void Net::refresh(Board& board)
+template <typename L>
+std::span<const i16> Network<L>::get_accumulator(i8 color)
 {
-    this->stack[this->index].refresh(board);
+    this->apply(this->index, color);
+
+    return std::span<const i16>(this->stack[this->index].data[color], L::HIDDEN);
 };
 
-void Net::make(Board& board, const u16& move)
+template <typename L>
+void Network<L>::refresh(Board& board, bool cached)
+{
+    auto& accumulator = this->stack[this->index];
+
+    for (i8 type = 0; type < 6; ++type) {
+        accumulator.pieces[type] = board.get_pieces(type);
+    }
+
+    for (i8 color = 0; color < 2; ++color) {
+        accumulator.colors[color] = board.get_colors(color);
+        accumulator.kings[color] = board.get_king_square(color);
+    }
+
+    for (i8 color = 0; color < 2; ++color) {
+        if (cached) {
+            accumulator.refresh(this->cache, color);
+        }
+        else {
+            accumulator.refresh(color);
+        }
+
+        accumulator.is_accurate[color] = true;
+        accumulator.is_refresh[color] = false;
+    }
+};
+
+template <typename L>
+void Network<L>::make(Board& board, const u16& move)
 {
     // Adds to stack
     this->index += 1;
 
+    auto& accumulator = this->stack[this->index];
+    const auto& parent = this->stack[this->index - 1];
+
     // Clears updates
-    auto& adds = this->stack[this->index].update.adds;
-    auto& subs = this->stack[this->index].update.subs;
+    auto& adds = accumulator.update.adds;
+    auto& subs = accumulator.update.subs;
 
     adds.clear();
     subs.clear();
@@ -216,6 +374,9 @@ void Net::make(Board& board, const u16& move)
     const auto color = board.get_color();
     const auto captured = move_type == move::type::CASTLING ? i8(piece::NONE) : board.get_piece_at(to);
 
+    accumulator.kings[color::WHITE] = parent.kings[color::WHITE];
+    accumulator.kings[color::BLACK] = parent.kings[color::BLACK];
+
     // Checks move type
     if (move_type == move::type::CASTLING) {
         bool castle_short = to > from;
@@ -227,6 +388,8 @@ void Net::make(Board& board, const u16& move)
         adds.add(Feature { .piece = piece::create(piece::type::ROOK, color), .square = rook_to });
         subs.add(Feature { .piece = piece::create(piece::type::KING, color), .square = from });
         subs.add(Feature { .piece = piece::create(piece::type::ROOK, color), .square = to });
+
+        accumulator.kings[color] = king_to;
     }
     else if (move_type == move::type::PROMOTION) {
         adds.add(Feature { .piece = piece::create(move::get_promotion_type(move), color), .square = to });
@@ -235,6 +398,10 @@ void Net::make(Board& board, const u16& move)
     else {
         adds.add(Feature { .piece = piece, .square = to });
         subs.add(Feature { .piece = piece, .square = from });
+
+        if (piece::get_type(piece) == piece::type::KING) {
+            accumulator.kings[color] = to;
+        }
     }
 
     // Checks capture
@@ -245,19 +412,576 @@ void Net::make(Board& board, const u16& move)
         subs.add(Feature { .piece = piece::create(piece::type::PAWN, !color), .square = i8(to ^ 8) });
     }
 
-    // Updates accumulator
-    this->stack[this->index].make(this->stack[this->index - 1], color::WHITE);
-    this->stack[this->index].make(this->stack[this->index - 1], color::BLACK);
+    // Defers the accumulator update until this position is evaluated
+    accumulator.is_accurate[color::WHITE] = false;
+    accumulator.is_accurate[color::BLACK] = false;
+    accumulator.is_refresh[color::WHITE] = false;
+    accumulator.is_refresh[color::BLACK] = false;
+    accumulator.is_fused = false;
+
+    // The mover's perspective is rebuilt through the cache when its king changes input bucket or side
+    if constexpr (L::CACHE > 1) {
+        if (nnue::get_cache_index<L>(color, accumulator.kings[color]) != nnue::get_cache_index<L>(color, parent.kings[color])) {
+            accumulator.is_refresh[color] = true;
+
+            for (i8 type = 0; type < 6; ++type) {
+                accumulator.pieces[type] = board.get_pieces(type);
+            }
+
+            accumulator.colors[color::WHITE] = board.get_colors(color::WHITE);
+            accumulator.colors[color::BLACK] = board.get_colors(color::BLACK);
+
+            // Applies the update to the pieces of the parent position
+            for (const auto& feature : subs) {
+                accumulator.pieces[piece::get_type(feature.piece)] ^= 1ULL << feature.square;
+                accumulator.colors[piece::get_color(feature.piece)] ^= 1ULL << feature.square;
+            }
+
+            for (const auto& feature : adds) {
+                accumulator.pieces[piece::get_type(feature.piece)] ^= 1ULL << feature.square;
+                accumulator.colors[piece::get_color(feature.piece)] ^= 1ULL << feature.square;
+            }
+        }
+    }
+
+    this->count_update += 1;
 };
 
-void Net::unmake()
+template <typename L>
+void Network<L>::unmake()
 {
+    // Counts the updates that were never written, fused leaves were still computed in the output layer
+    const auto& accumulator = this->stack[this->index];
+
+    if (!accumulator.is_accurate[color::WHITE] && !accumulator.is_accurate[color::BLACK]) {
+        if (accumulator.is_fused) {
+            this->count_fused += 1;
+        }
+        else {
+            this->count_skip += 1;
+        }
+    }
+
     this->index -= 1;
 };
 
+template <typename L>
+void Network<L>::apply(usize target, i8 color)
+{
+    if (this->stack[target].is_accurate[color]) {
+        return;
+    }
+
+    // Walks back to the last accurate accumulator or to the last refresh, the root is always accurate
+    usize start = target;
+
+    while (!this->stack[start].is_accurate[color] && !this->stack[start].is_refresh[color])
+    {
+        start -= 1;
+    }
+
+    if (!this->stack[start].is_accurate[color]) {
+        this->stack[start].refresh(this->cache, color);
+        this->stack[start].is_accurate[color] = true;
+    }
+
+    // Applies the pending updates in order
+    for (usize i = start + 1; i <= target; ++i) {
+        this->stack[i].make(this->stack[i - 1], color);
+        this->stack[i].is_accurate[color] = true;
+    }
+};
+
+Net::Net()
+{
+    this->active = nullptr;
+    this->generation = 0;
+    this->clear();
+};
+
+void Net::clear()
+{
+    const bool is_empty = std::visit([] (auto& network) { return network == nullptr; }, this->network);
+
+    // Another net may have been loaded since the last search
+    if (is_empty || this->generation != nnue::generation) {
+        nnue::with_layout(nnue::shape, [&] <typename L> (L) {
+            auto network = std::make_unique<Network<L>>();
+
+            this->active = network.get();
+            this->network = std::move(network);
+
+            this->call_make = [] (void* network, Board& board, const u16& move) {
+                static_cast<Network<L>*>(network)->make(board, move);
+            };
+
+            this->call_unmake = [] (void* network) {
+                static_cast<Network<L>*>(network)->unmake();
+            };
+
+            this->call_eval = [] (void* network, Board& board) {
+                return static_cast<Network<L>*>(network)->get_eval(board);
+            };
+        });
+
+        this->generation = nnue::generation;
+    }
+
+    std::visit([&] (auto& network) { network->clear(); }, this->network);
+};
+
+template <bool FUSED>
+i32 Net::get_eval(Board& board)
+{
+    if constexpr (FUSED) {
+        return this->call_eval(this->active, board);
+    }
+
+    return std::visit([&] (auto& network) { return network->template get_eval<FUSED>(board); }, this->network);
+};
+
+// Search always fuses, the unfused evaluation is only compared against in the bench
+template i32 Net::get_eval<true>(Board&);
+template i32 Net::get_eval<false>(Board&);
+
+std::span<const i16> Net::get_accumulator(i8 color)
+{
+    return std::visit([&] (auto& network) { return network->get_accumulator(color); }, this->network);
+};
+
+u64 Net::get_count_update()
+{
+    return std::visit([&] (auto& network) { return network->count_update; }, this->network);
+};
+
+u64 Net::get_count_skip()
+{
+    return std::visit([&] (auto& network) { return network->count_skip; }, this->network);
+};
+
+u64 Net::get_count_fused()
+{
+    return std::visit([&] (auto& network) { return network->count_fused; }, this->network);
+};
+
+void Net::refresh(Board& board, bool cached)
+{
+    std::visit([&] (auto& network) { network->refresh(board, cached); }, this->network);
+};
+
+void Net::make(Board& board, const u16& move)
+{
+    this->call_make(this->active, board, move);
+};
+
+void Net::unmake()
+{
+    this->call_unmake(this->active);
+};
+
+// Positions evaluated together and the part of the hidden layer computed at once
+// The weights of a chunk that a block reads mostly stay in cache, since the positions of a block share most of their features
+constexpr usize BATCH_BLOCK = 32;
+constexpr usize BATCH_CHUNK = 256;
+
+// Builds the accumulators of a block of positions from scratch and evaluates them
+// Rows are added 4 at a time so that the accumulator chunk stays in registers
+template <typename L>
+static void evaluate_block(const Position* positions, i32* evals, usize count)
+{
+    constexpr usize CHUNK = std::min(L::HIDDEN, BATCH_CHUNK);
+
+    static_assert(L::HIDDEN % CHUNK == 0);
+
+    alignas(64) i16 accumulator[CHUNK];
+
+    u16 features[BATCH_BLOCK][2][32];
+    usize feature_counts[BATCH_BLOCK];
+    usize output_buckets[BATCH_BLOCK];
+    i32 scores[BATCH_BLOCK] = {};
+
+    for (usize i = 0; i < count; ++i) {
+        const auto& position = positions[i];
+        const u64 occupied = position.colors[color::WHITE] | position.colors[color::BLACK];
+
+        // batch::run checks the piece count and the kings of every fen it reads
+        assert(bitboard::get_count(occupied) <= 32);
+        assert(bitboard::get_count(position.pieces[piece::type::KING] & position.colors[color::WHITE]) == 1);
+        assert(bitboard::get_count(position.pieces[piece::type::KING] & position.colors[color::BLACK]) == 1);
+
+        feature_counts[i] = bitboard::get_count(occupied);
+        output_buckets[i] = nnue::get_output_bucket<L>(occupied);
+
+        for (usize side = 0; side < 2; ++side) {
+            const i8 perspective = side == 0 ? position.color : !position.color;
+            const i8 king = bitboard::get_lsb(position.pieces[piece::type::KING] & position.colors[perspective]);
+
+            // Kings come first
+            usize k = 0;
+
+            for (i8 type = piece::type::KING; type >= 0; --type) {
+                for (i8 piece_color = 0; piece_color < 2; ++piece_color) {
+                    u64 pieces = position.pieces[type] & position.colors[piece_color];
+
+                    while (pieces)
+                    {
+                        const auto square = bitboard::pop_lsb(pieces);
+
+                        features[i][side][k++] = u16(Feature { .piece = piece::create(type, piece_color), .square = square }.template get_index<L>(perspective, king));
+                    }
+                }
+            }
+        }
+    }
+
+    for (usize offset = 0; offset < L::HIDDEN; offset += CHUNK) {
+        const auto& weights = params<L>->in_weights;
+
+        for (usize i = 0; i < count; ++i) {
+            for (usize side = 0; side < 2; ++side) {
+                const auto feature = features[i][side];
+
+                // Every position has both kings
+                const typename L::Weight* rows[4] = { &weights[feature[0]][offset], &weights[feature[1]][offset] };
+
+                kernel::edit<CHUNK, 2, 0>(accumulator, &params<L>->in_biases[offset], rows, rows);
+
+                usize k = 2;
+
+                for (; k + 4 <= feature_counts[i]; k += 4) {
+                    for (usize n = 0; n < 4; ++n) {
+                        rows[n] = &weights[feature[k + n]][offset];
+                    }
+
+                    kernel::edit<CHUNK, 4, 0>(accumulator, accumulator, rows, rows);
+                }
+
+                for (; k < feature_counts[i]; ++k) {
+                    rows[0] = &weights[feature[k]][offset];
+
+                    kernel::edit<CHUNK, 1, 0>(accumulator, accumulator, rows, rows);
+                }
+
+                // The output layer is a sum over the hidden layer, so it's accumulated chunk by chunk
+                scores[i] += kernel::get_linear<CHUNK, scale::L0>(accumulator, &params<L>->out_weights[output_buckets[i]][side][offset]);
+            }
+        }
+    }
+
+    for (usize i = 0; i < count; ++i) {
+        evals[i] = (scores[i] / scale::L0 + params<L>->out_biases[output_buckets[i]]) * scale::EVAL / (scale::L0 * scale::L1);
+    }
+};
+
+Position get_position(Board& board)
+{
+    auto position = Position();
+
+    for (i8 type = 0; type < 6; ++type) {
+        position.pieces[type] = board.get_pieces(type);
+    }
+
+    position.colors[color::WHITE] = board.get_colors(color::WHITE);
+    position.colors[color::BLACK] = board.get_colors(color::BLACK);
+    position.color = board.get_color();
+
+    return position;
+};
+
+// Evaluates positions outside of any search, each eval is the same as the one of a refreshed network
+// Every thread gets a contiguous range of whole blocks
+void evaluate(std::span<const Position> positions, std::span<i32> evals, usize thread_count)
+{
+    assert(positions.size() == evals.size());
+
+    if (positions.empty()) {
+        return;
+    }
+
+    nnue::with_layout(nnue::shape, [&] <typename L> (L) {
+        const usize block_count = (positions.size() + BATCH_BLOCK - 1) / BATCH_BLOCK;
+        const usize worker_count = std::max(thread_count, usize(1));
+        const usize range = (block_count + worker_count - 1) / worker_count * BATCH_BLOCK;
+
+        auto work = [&] (usize start, usize end) {
+            for (usize i = start; i < end; i += BATCH_BLOCK) {
+                nnue::evaluate_block<L>(&positions[i], &evals[i], std::min(BATCH_BLOCK, end - i));
+            }
+        };
+
+        std::vector<std::thread> threads;
+
+        for (usize start = range; start < positions.size(); start += range) {
+            threads.emplace_back(work, start, std::min(start + range, positions.size()));
+        }
+
+        work(0, std::min(range, positions.size()));
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    });
+};
+
+// Applies a net, nets with a header pick their shape from it, nets without one are read as the first shape
+// The parameters are used in place if they are aligned and the memory outlives them, otherwise they are copied
+static Error apply(const u8* data, usize size, bool in_place)
+{
+    usize index = 0;
+    usize offset = 0;
+    u8 map[64] = {};
+    std::optional<u64> checksum = {};
+
+    if (size >= sizeof(Header) && std::memcmp(data, MAGIC, sizeof(MAGIC)) == 0) {
+        Header header;
+        std::memcpy(&header, data, sizeof(Header));
+
+        if (header.version != VERSION) {
+            return Error::VERSION;
+        }
+
+        bool found = false;
+
+        for (usize i = 0; i < LAYOUT_COUNT && !found; ++i) {
+            found = nnue::with_layout(i, [&] <typename L> (L) {
+                return
+                    header.hidden == L::HIDDEN &&
+                    header.input_bucket == L::INPUT_BUCKET &&
+                    header.output_bucket == L::OUTPUT_BUCKET &&
+                    bool(header.mirror) == L::MIRROR &&
+                    (header.weight == 0 ? 16 : header.weight) == 8 * sizeof(typename L::Weight);
+            });
+
+            index = i;
+        }
+
+        if (!found) {
+            return Error::SHAPE;
+        }
+
+        for (usize square = 0; square < 64; ++square) {
+            if (header.buckets[square] >= header.input_bucket) {
+                return Error::BUCKET;
+            }
+        }
+
+        std::memcpy(map, header.buckets, sizeof(map));
+
+        offset = sizeof(Header);
+        checksum = header.checksum;
+    }
+
+    return nnue::with_layout(index, [&] <typename L> (L) {
+        // Nets without a header may be padded at the end
+        if (checksum.has_value() ? size - offset != nnue::get_size<L>() : size - offset < nnue::get_size<L>()) {
+            return Error::SIZE;
+        }
+
+        if (checksum.has_value() && nnue::get_checksum(data + offset, nnue::get_size<L>()) != checksum.value()) {
+            return Error::CHECKSUM;
+        }
+
+        void* memory = nullptr;
+
+        if (!in_place || reinterpret_cast<uintptr_t>(data + offset) % alignof(Parameters<L>) != 0) {
+            // The padding at the end of the struct stays zero
+            memory = malloc_aligned(alignof(Parameters<L>), sizeof(Parameters<L>));
+
+            std::memset(memory, 0, sizeof(Parameters<L>));
+            std::memcpy(memory, data + offset, nnue::get_size<L>());
+        }
+
+        if (storage != nullptr) {
+            free_aligned(storage);
+        }
+
+        storage = memory;
+
+        params<L> = reinterpret_cast<const Parameters<L>*>(memory != nullptr ? memory : data + offset);
+        nnue::shape = index;
+        nnue::output_bucket = L::OUTPUT_BUCKET;
+        nnue::generation += 1;
+        std::memcpy(nnue::buckets, map, sizeof(map));
+
+        return Error::NONE;
+    });
+};
+
+std::string get_error_name(Error error)
+{
+    switch (error)
+    {
+    case Error::NONE:
+        return "no error";
+    case Error::FILE:
+        return "file can't be read";
+    case Error::VERSION:
+        return "unknown version";
+    case Error::SHAPE:
+        return "unsupported shape";
+    case Error::BUCKET:
+        return "invalid input buckets";
+    case Error::SIZE:
+        return "size doesn't match the shape";
+    case Error::CHECKSUM:
+        return "checksum mismatch";
+    }
+
+    return "unknown error";
+};
+
+// Fnv-1a over 8 byte words
+u64 get_checksum(const u8* data, usize size)
+{
+    constexpr u64 PRIME = 0x100000001B3ULL;
+
+    u64 hash = 0xCBF29CE484222325ULL;
+    usize i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+        u64 word;
+        std::memcpy(&word, data + i, sizeof(word));
+
+        hash = (hash ^ word) * PRIME;
+    }
+
+    for (; i < size; ++i) {
+        hash = (hash ^ data[i]) * PRIME;
+    }
+
+    return hash;
+};
+
+// Copies the net, the memory can be freed once this returns
+Error load(const u8* data, usize size)
+{
+    const auto error = nnue::apply(data, size, false);
+
+    if (error == Error::NONE) {
+        file::unmap(mapping);
+    }
+
+    return error;
+};
+
+// Maps the net file and reads it in place, the embedded net stays in use if it fails
+Error load(const std::string& path)
+{
+    auto mapped = file::map(path);
+
+    if (!mapped.has_value()) {
+        return Error::FILE;
+    }
+
+    const auto error = nnue::apply(mapped->data, mapped->size, true);
+
+    if (error != Error::NONE) {
+        file::unmap(mapped.value());
+        return error;
+    }
+
+    // The old mapping is released after the new parameters are in place
+    file::unmap(mapping);
+    mapping = mapped.value();
+
+    return Error::NONE;
+};
+
+// Writes the loaded net with a header
+bool save(const std::string& path)
+{
+    return nnue::with_layout(nnue::shape, [&] <typename L> (L) {
+        const auto data = reinterpret_cast<const u8*>(params<L>);
+
+        Header header = {};
+
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        std::memcpy(header.buckets, nnue::buckets, sizeof(header.buckets));
+
+        header.version = VERSION;
+        header.hidden = L::HIDDEN;
+        header.input_bucket = L::INPUT_BUCKET;
+        header.output_bucket = L::OUTPUT_BUCKET;
+        header.mirror = L::MIRROR;
+        header.checksum = nnue::get_checksum(data, nnue::get_size<L>());
+        header.weight = 8 * sizeof(typename L::Weight);
+
+        std::ofstream file(path, std::ios::binary);
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        file.write(reinterpret_cast<const char*>(data), nnue::get_size<L>());
+
+        return file.good();
+    });
+};
+
+// Converts the loaded net to its int8 twin, weights that don't fit are saturated and counted
+// Nets trained with int8 weights in mind convert exactly
+usize quantize()
+{
+    return nnue::with_layout(nnue::shape, [] <typename L> (L) {
+        if constexpr (std::is_same_v<typename L::Weight, i8>) {
+            return usize(0);
+        }
+        else {
+            using Q = typename L::Quantized;
+
+            auto memory = static_cast<Parameters<Q>*>(malloc_aligned(alignof(Parameters<Q>), sizeof(Parameters<Q>)));
+            usize clamped = 0;
+
+            std::memset(memory, 0, sizeof(Parameters<Q>));
+
+            for (usize i = 0; i < L::INPUT_BUCKET * size::INPUT; ++i) {
+                for (usize k = 0; k < L::HIDDEN; ++k) {
+                    const i16 weight = params<L>->in_weights[i][k];
+                    const i16 saturated = std::clamp(weight, i16(INT8_MIN), i16(INT8_MAX));
+
+                    memory->in_weights[i][k] = i8(saturated);
+                    clamped += saturated != weight;
+                }
+            }
+
+            std::memcpy(memory->in_biases, params<L>->in_biases, sizeof(memory->in_biases));
+            std::memcpy(memory->out_weights, params<L>->out_weights, sizeof(memory->out_weights));
+            std::memcpy(memory->out_biases, params<L>->out_biases, sizeof(memory->out_biases));
+
+            // The int16 net isn't needed anymore
+            if (storage != nullptr) {
+                free_aligned(storage);
+            }
+
+            file::unmap(mapping);
+
+            storage = memory;
+
+            params<Q> = memory;
+            nnue::shape = nnue::get_layout_index<Q>();
+            nnue::output_bucket = Q::OUTPUT_BUCKET;
+            nnue::generation += 1;
+
+            return clamped;
+        }
+    });
+};
+
+std::string get_name()
+{
+    return nnue::with_layout(nnue::shape, [] <typename L> (L) {
+        return
+            "(" + std::to_string(size::INPUT) + "x" + std::to_string(L::INPUT_BUCKET) + (L::MIRROR ? "hm" : "") +
+            " -> " + std::to_string(L::HIDDEN) + ")x2 -> " + std::to_string(L::OUTPUT_BUCKET) +
+            (std::is_same_v<typename L::Weight, i8> ? " int8" : "");
+    });
+};
+
 void init()
 {
-    std::memcpy((void*)&PARAMS, nnue_raw_data, sizeof(PARAMS));
+    const auto error = nnue::apply(nnue_raw_data, nnue_raw_size, true);
+
+    assert(error == Error::NONE);
+    (void)error;
+
+    file::unmap(mapping);
 };
 
 };
\ No newline at end of file
@@ -3,12 +3,18 @@
 #define INCBIN_PREFIX
 #define INCBIN_STYLE INCBIN_STYLE_SNAKE
 
+#include <memory>
+#include <span>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <variant>
+
 #include "../chess/chess.h"
 #include "../util/incbin.h"
-
-#ifdef __AVX2__
-    #include <x86intrin.h>
-#endif
+#include "../util/alloc.h"
+#include "../util/file.h"
+#include "kernel.h"
 
 namespace nnue
 {
@@ -16,7 +22,6 @@ namespace nnue
 namespace size
 {
     constexpr usize INPUT = 768;
-    constexpr usize HIDDEN = 128;
 };
 
 namespace scale
@@ -26,15 +31,122 @@ namespace scale
     constexpr i32 L1 = 64;
 };
 
+// Shape of a network, each supported shape gets its own accumulators and kernels specialized at compile time
+// The input weights are stored as int16 or as int8, the accumulators are always int16
+template <usize HIDDEN_SIZE, usize INPUT_BUCKETS, usize OUTPUT_BUCKETS, bool IS_MIRRORED, typename WEIGHT = i16>
+struct Layout
+{
+    static constexpr usize HIDDEN = HIDDEN_SIZE;
+    static constexpr usize INPUT_BUCKET = INPUT_BUCKETS;
+    static constexpr usize OUTPUT_BUCKET = OUTPUT_BUCKETS;
+    static constexpr bool MIRROR = IS_MIRRORED;
+
+    using Weight = WEIGHT;
+    using Quantized = Layout<HIDDEN_SIZE, INPUT_BUCKETS, OUTPUT_BUCKETS, IS_MIRRORED, i8>;
+
+    // Cache entries per perspective, mirrored nets keep both halves of every input bucket
+    static constexpr usize CACHE = INPUT_BUCKET * (MIRROR ? 2 : 1);
+
+    static_assert(HIDDEN % 32 == 0);
+    static_assert(std::is_same_v<Weight, i16> || std::is_same_v<Weight, i8>);
+};
+
+// Every shape that can be loaded, the first one is the shape of nets without a header
+// Each shape has an int8 twin that nets are quantized to
+using Layouts = std::tuple<
+    Layout<128, 1, 1, false>,
+    Layout<256, 1, 8, true>,
+    Layout<512, 4, 8, true>,
+    Layout<1024, 8, 8, true>,
+    Layout<1536, 16, 8, true>,
+    Layout<128, 1, 1, false, i8>,
+    Layout<256, 1, 8, true, i8>,
+    Layout<512, 4, 8, true, i8>,
+    Layout<1024, 8, 8, true, i8>,
+    Layout<1536, 16, 8, true, i8>
+>;
+
+constexpr usize LAYOUT_COUNT = std::tuple_size_v<Layouts>;
+
+template <typename L, usize I = 0>
+constexpr usize get_layout_index()
+{
+    static_assert(I < LAYOUT_COUNT);
+
+    if constexpr (std::is_same_v<L, std::tuple_element_t<I, Layouts>>) {
+        return I;
+    }
+    else {
+        return nnue::get_layout_index<L, I + 1>();
+    }
+};
+
+// Calls the function with the layout of the given shape
+template <typename F, usize I = 0>
+inline auto with_layout(usize index, F&& function)
+{
+    if constexpr (I + 1 == LAYOUT_COUNT) {
+        return function(std::tuple_element_t<I, Layouts>());
+    }
+    else {
+        if (index == I) {
+            return function(std::tuple_element_t<I, Layouts>());
+        }
+
+        return nnue::with_layout<F, I + 1>(index, std::forward<F>(function));
+    }
+};
+
+// Nets with a header describe their own shape and the input bucket of every king square
+// The checksum covers the parameters that follow the header
+// The width of the input weights is in bits, older nets left it zero and are stored as int16
+struct Header
+{
+    char magic[4];
+    u32 version;
+    u32 hidden;
+    u32 input_bucket;
+    u32 output_bucket;
+    u32 mirror;
+    u8 buckets[64];
+    u64 checksum;
+    u32 weight;
+    u8 padding[28];
+};
+
+static_assert(sizeof(Header) == 128);
+
+constexpr char MAGIC[4] = { 'I', 'R', 'I', 'S' };
+constexpr u32 VERSION = 1;
+
+template <typename L>
 struct Parameters
 {
-    alignas(32) i16 in_weights[size::INPUT][size::HIDDEN];
-    alignas(32) i16 in_biases[size::HIDDEN];
-    alignas(32) i16 out_weights[2][size::HIDDEN];
-    alignas(32) i16 out_bias;
+    alignas(64) typename L::Weight in_weights[L::INPUT_BUCKET * size::INPUT][L::HIDDEN];
+    alignas(64) i16 in_biases[L::HIDDEN];
+    alignas(64) i16 out_weights[L::OUTPUT_BUCKET][2][L::HIDDEN];
+    alignas(64) i16 out_biases[L::OUTPUT_BUCKET];
 };
 
-inline Parameters PARAMS;
+// Size of the parameters in a net file, the padding at the end of the struct isn't stored
+template <typename L>
+constexpr usize get_size()
+{
+    return offsetof(Parameters<L>, out_biases) + sizeof(i16) * L::OUTPUT_BUCKET;
+};
+
+// Parameters of the loaded net, only the pointer of the active shape is set
+template <typename L>
+inline const Parameters<L>* params = nullptr;
+
+// Index of the active shape in the layouts and the input bucket of every king square, from the perspective of white
+// The output bucket count of the shape is kept too, since every eval reads it
+inline usize shape = 0;
+inline usize output_bucket = 1;
+inline u8 buckets[64] = {};
+
+// Counts the loaded nets, networks built for an older net are rebuilt since their caches hold its weights
+inline u64 generation = 0;
 
 class Feature
 {
@@ -42,7 +154,7 @@ public:
     i8 piece = piece::NONE;
     i8 square = square::NONE;
 public:
-    usize get_index(i8 color);
+    template <typename L> usize get_index(i8 color, i8 king);
 };
 
 struct Update
@@ -51,82 +163,141 @@ struct Update
     arrayvec<Feature, 2> subs = {};
 };
 
+// Last accumulator of each perspective and input bucket with the pieces it was built from
+template <typename L>
+struct CacheEntry
+{
+    alignas(64) i16 data[L::HIDDEN];
+    u64 pieces[6];
+    u64 colors[2];
+};
+
+template <typename L>
+class Cache
+{
+public:
+    CacheEntry<L> entries[2][L::CACHE];
+public:
+    Cache();
+public:
+    void clear();
+};
+
+template <typename L>
 class Accumulator
 {
 public:
-    alignas(32) i16 data[2][size::HIDDEN];
+    alignas(64) i16 data[2][L::HIDDEN];
     Update update;
+    i8 kings[2];
+    bool is_accurate[2];
+    bool is_refresh[2];
+    bool is_fused;
 public:
-    void clear();
-    void refresh(Board& board);
+    // Pieces of this position, only set when a perspective has to be refreshed
+    u64 pieces[6];
+    u64 colors[2];
+public:
+    void clear(i8 color);
+    void refresh(i8 color);
+    void refresh(Cache<L>& cache, i8 color);
     void make(const Accumulator& parent, i8 color);
+    i32 get_linear(const Accumulator& parent, i8 color, const i16* weights);
 public:
     void edit_add1_sub1(const Accumulator& parent, usize add1, usize sub1, i8 color);
     void edit_add1_sub2(const Accumulator& parent, usize add1, usize sub1, usize sub2, i8 color);
     void edit_add2_sub2(const Accumulator& parent, usize add1, usize add2, usize sub1, usize sub2, i8 color);
 };
 
-class Net
+// Accumulators are updated lazily, a move only records its update and the accumulator is computed when it's evaluated
+// King moves that change the input bucket refresh the mover's perspective through the cache instead
+template <typename L>
+class Network
 {
 private:
-    Accumulator stack[MAX_PLY + 8];
+    Accumulator<L> stack[MAX_PLY + 8];
+    Cache<L> cache;
     usize index;
 public:
-    Net();
+    u64 count_update;
+    u64 count_skip;
+    u64 count_fused;
 public:
-    i32 get_eval(i8 color);
+    Network();
 public:
-    void refresh(Board& board);
+    void clear();
+    template <bool FUSED = true> i32 get_eval(Board& board);
+    std::span<const i16> get_accumulator(i8 color);
+public:
+    void refresh(Board& board, bool cached);
     void make(Board& board, const u16& move);
     void unmake();
+    void apply(usize target, i8 color);
 };
 
-#ifdef __AVX2__
-    template <usize SIZE, i32 SCALE>
-    constexpr __m256i get_linear(i16 inputs[SIZE], i16 weights[SIZE])
-    {
-        auto vec = _mm256_setzero_si256();
+template <typename... Ls>
+std::variant<std::unique_ptr<Network<Ls>>...> get_variant(std::tuple<Ls...>);
 
-        for (usize i = 0; i < SIZE; i += 16) {
-            // Loads input vector
-            auto input = _mm256_load_si256((const __m256i*)&inputs[i]);
+// Network of the active shape, every call is dispatched once to the specialized network
+// The calls made on every node are bound to the network when it's built, so they skip the dispatch
+class Net
+{
+private:
+    decltype(nnue::get_variant(Layouts())) network;
+    void* active;
+    void (*call_make)(void* network, Board& board, const u16& move);
+    void (*call_unmake)(void* network);
+    i32 (*call_eval)(void* network, Board& board);
+    u64 generation;
+public:
+    Net();
+public:
+    void clear();
+    template <bool FUSED = true> i32 get_eval(Board& board);
+    std::span<const i16> get_accumulator(i8 color);
+    u64 get_count_update();
+    u64 get_count_skip();
+    u64 get_count_fused();
+public:
+    void refresh(Board& board, bool cached = true);
+    void make(Board& board, const u16& move);
+    void unmake();
+};
 
-            // Calculates clipped relu
-            auto crelu = _mm256_min_epi16(_mm256_max_epi16(input, _mm256_setzero_si256()), _mm256_set1_epi16(i16(SCALE)));
+enum class Error
+{
+    NONE,
+    FILE,
+    VERSION,
+    SHAPE,
+    BUCKET,
+    SIZE,
+    CHECKSUM
+};
 
-            // Loads weight vector
-            auto weight = _mm256_load_si256((const __m256i*)&weights[i]);
+std::string get_error_name(Error error);
 
-            // Calculates screlu * weight by doing (crelu * weight) * crelu
-            auto product = _mm256_madd_epi16(_mm256_mullo_epi16(crelu, weight), crelu);
+u64 get_checksum(const u8* data, usize size);
 
-            // Adds the results
-            vec = _mm256_add_epi32(vec, product);
-        }
+Error load(const u8* data, usize size);
+Error load(const std::string& path);
+bool save(const std::string& path);
 
-        return vec;
-    };
-#else
-    template <i32 SCALE>
-    constexpr i32 get_screlu(i32 input)
-    {
-        i32 value = std::clamp(input, 0, SCALE);
+usize quantize();
 
-        return value * value;
-    };
+// Pieces of a position without the state of a board, so that millions of them can be kept in memory
+struct Position
+{
+    u64 pieces[6];
+    u64 colors[2];
+    i8 color;
+};
 
-    template <usize SIZE, i32 SCALE>
-    constexpr i32 get_linear(i16 inputs[SIZE], i16 weights[SIZE])
-    {
-        i32 value = 0;
+Position get_position(Board& board);
 
-        for (usize i = 0; i < SIZE; ++i) {
-            value += get_screlu<SCALE>(inputs[i]) * weights[i];
-        }
+void evaluate(std::span<const Position> positions, std::span<i32> evals, usize thread_count);
 
-        return value;
-    };
-#endif
+std::string get_name();
 
 void init();
 
@@ -12,13 +12,4 @@ enum class Type
     NORMAL
 };
 
-class Counter
-{
-public:
-    u64 data[64 * 64] = { 0 };
-public:
-    u64 get(const u16& move);
-    void set(const u16& move, u64 count);
-};
-
 };
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "pool.h"
+
+namespace pool
+{
+
+Worker::Worker()
+{
+    this->busy = true;
+    this->exiting = false;
+    this->thread = std::thread(&Worker::loop, this);
+
+    // Waits until the thread is idle
+    this->wait();
+};
+
+Worker::~Worker()
+{
+    this->wait();
+
+    {
+        std::lock_guard<std::mutex> lk(this->mutex);
+        this->exiting = true;
+    }
+
+    this->cv.notify_all();
+    this->thread.join();
+};
+
+void Worker::run(std::function<void()> task)
+{
+    this->wait();
+
+    {
+        std::lock_guard<std::mutex> lk(this->mutex);
+        this->task = std::move(task);
+        this->busy = true;
+    }
+
+    this->cv.notify_all();
+};
+
+bool Worker::wait()
+{
+    std::unique_lock<std::mutex> lk(this->mutex);
+
+    const bool was_busy = this->busy;
+
+    this->cv.wait(lk, [&] { return !this->busy; });
+
+    return was_busy;
+};
+
+bool Worker::is_busy()
+{
+    std::lock_guard<std::mutex> lk(this->mutex);
+
+    return this->busy;
+};
+
+void Worker::loop()
+{
+    while (true)
+    {
+        std::function<void()> current;
+
+        {
+            std::unique_lock<std::mutex> lk(this->mutex);
+
+            // Marks this thread as idle
+            this->busy = false;
+            this->cv.notify_all();
+
+            // Sleeps until there is a new task
+            this->cv.wait(lk, [&] { return this->busy || this->exiting; });
+
+            if (this->exiting) {
+                return;
+            }
+
+            current = std::move(this->task);
+        }
+
+        current();
+    }
+};
+
+};
\ No newline at end of file
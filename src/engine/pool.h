@@ -0,0 +1,35 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+
+#include "../chess/chess.h"
+
+namespace pool
+{
+
+// A long lived thread that sleeps until it is given a task
+class Worker
+{
+private:
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::function<void()> task;
+    bool busy;
+    bool exiting;
+public:
+    Worker();
+    ~Worker();
+public:
+    void run(std::function<void()> task);
+    bool wait();
+    bool is_busy();
+private:
+    void loop();
+};
+
+};
\ No newline at end of file
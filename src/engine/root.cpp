@@ -0,0 +1,110 @@
+#include "root.h"
+#include "order.h"
+
+namespace root
+{
+
+void List::init(Data& data, u16 hasher, const std::vector<u16>& searchmoves)
+{
+    this->moves.clear();
+
+    // Uses the move picker once to get a good ordering for the first iteration
+    auto picker = order::Picker(data, hasher);
+
+    while (true)
+    {
+        const u16 move = picker.get(data);
+
+        if (!move) {
+            break;
+        }
+
+        if (!data.board.is_legal(move)) {
+            continue;
+        }
+
+        // Restricts the search to the given moves
+        if (!searchmoves.empty() && std::find(searchmoves.begin(), searchmoves.end(), move) == searchmoves.end()) {
+            continue;
+        }
+
+        Move root_move = Move();
+
+        root_move.move = move;
+        root_move.pv.data[0] = move;
+        root_move.pv.count = 1;
+
+        this->moves.add(root_move);
+    }
+};
+
+void List::clear()
+{
+    this->moves.clear();
+};
+
+void List::prepare()
+{
+    // Moves that aren't searched again in this iteration keep their ordering from the previous one
+    for (auto& root_move : this->moves) {
+        root_move.score_previous = root_move.score;
+        root_move.score = -eval::score::INFINITE;
+        root_move.nodes = 0;
+    }
+};
+
+void List::set_late(Data& data, usize begin)
+{
+    if (begin >= this->moves.size()) {
+        return;
+    }
+
+    // Root moves are reduced like the moves of any other node, as if the first move searched was the table move
+    // The order changes between searches, so this is done again before every one of them
+    auto picker = order::Picker(data, this->moves[begin].move);
+
+    while (true)
+    {
+        const u16 move = picker.get(data);
+
+        if (!move) {
+            break;
+        }
+
+        for (usize i = begin; i < this->moves.size(); ++i) {
+            if (this->moves[i].move == move) {
+                this->moves[i].is_late = picker.get_stage() > order::Stage::KILLER;
+                break;
+            }
+        }
+    }
+};
+
+void List::update(usize index, i32 score, i32 seldepth, const pv::Line& pv)
+{
+    auto& root_move = this->moves[index];
+
+    root_move.score = score;
+    root_move.seldepth = seldepth;
+    root_move.pv.update(root_move.move, pv);
+
+    if (root_move.score_average == -eval::score::INFINITE) {
+        root_move.score_average = score;
+    }
+    else {
+        root_move.score_average = (root_move.score_average + score) / 2;
+    }
+};
+
+void List::sort(usize begin)
+{
+    std::stable_sort(this->moves.begin() + begin, this->moves.end(), [&] (const Move& a, const Move& b) {
+        if (a.score != b.score) {
+            return a.score > b.score;
+        }
+
+        return a.score_previous > b.score_previous;
+    });
+};
+
+};
\ No newline at end of file
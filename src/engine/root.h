@@ -0,0 +1,51 @@
+#pragma once
+
+#include "pv.h"
+#include "eval.h"
+
+class Data;
+
+namespace root
+{
+
+struct Move
+{
+    u16 move = move::NONE;
+    bool is_late = false;
+    i32 score = -eval::score::INFINITE;
+    i32 score_previous = -eval::score::INFINITE;
+    i32 score_average = -eval::score::INFINITE;
+    i32 seldepth = 0;
+    u64 nodes = 0;
+    pv::Line pv = pv::Line();
+};
+
+// Legal moves of the root position, generated once per search and ordered by their scores between iterations
+class List
+{
+private:
+    arrayvec<Move, move::MAX> moves;
+public:
+    void init(Data& data, u16 hasher, const std::vector<u16>& searchmoves = {});
+    void clear();
+public:
+    Move& operator [] (usize index);
+    usize size();
+public:
+    void prepare();
+    void set_late(Data& data, usize begin);
+    void update(usize index, i32 score, i32 seldepth, const pv::Line& pv);
+    void sort(usize begin);
+};
+
+inline Move& List::operator [] (usize index)
+{
+    return this->moves[index];
+};
+
+inline usize List::size()
+{
+    return this->moves.size();
+};
+
+};
\ No newline at end of file
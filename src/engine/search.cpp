@@ -5,167 +5,465 @@ namespace search
 
 Engine::Engine()
 {
+    this->thread_count = 0;
+    this->numa = false;
+    this->huge = false;
+    this->multipv = 1;
+    this->evalfile = "";
+    this->int8 = false;
+    this->eval_cache = 0;
+    this->pondering = false;
     this->clear();
 };
 
-void Engine::clear()
+Engine::~Engine()
 {
-    this->running.clear();
-    this->threads.clear();
+    this->stop();
+};
+
+void Engine::clear(bool lazy)
+{
+    this->stop();
     this->timer.clear();
-    this->table.clear();
+
+    if (lazy) {
+        this->table.invalidate();
+    }
+    else {
+        this->clear_table();
+    }
+
     this->nodes = 0;
     this->time = 0;
+    this->nnue_update = 0;
+    this->nnue_skip = 0;
+    this->nnue_fused = 0;
+    this->eval_probe = 0;
+    this->eval_hit = 0;
+    this->start = 0;
+    this->started = 0;
+    this->latency = 0;
+    this->clear_history();
 };
 
-void Engine::set(uci::parse::Setoption uci_setoption)
+void Engine::clear_table()
 {
-    this->table.init(uci_setoption.hash);
-    this->thread_count = uci_setoption.threads;
+    this->stop();
+
+    if (this->workers.empty()) {
+        const u64 time_start = timer::get_current();
+
+        this->table.clear();
+
+        this->table.time_clear = timer::get_current() - time_start;
+
+        return;
+    }
+
+    this->workers[0]->run([this] () {
+        this->build_table({});
+    });
+
+    this->join();
 };
 
-bool Engine::stop()
+// Reallocates the table if a size is given, then clears it
+// Runs on the first thread, which wakes the others, so the caller doesn't have to wait for it
+void Engine::build_table(std::optional<u64> mb)
 {
-    if (this->threads.empty()) {
-        return false;
+    if (mb.has_value()) {
+        this->table.init(mb.value(), this->huge);
     }
 
-    this->running.clear();
+    const u64 time_start = timer::get_current();
 
-    return this->join();
+    // Each thread clears its own part of the table, which also places the pages on its node in numa mode
+    for (u64 i = 1; i < this->workers.size(); ++i) {
+        this->workers[i]->run([this, i] () {
+            this->table.clear(i, this->workers.size());
+        });
+    }
+
+    this->table.clear(0, this->workers.size());
+
+    for (u64 i = 1; i < this->workers.size(); ++i) {
+        this->workers[i]->wait();
+    }
+
+    this->table.time_clear = timer::get_current() - time_start;
 };
 
-bool Engine::join()
+void Engine::clear_history()
 {
-    if (this->threads.empty()) {
-        return false;
+    this->stop();
+
+    // Each thread clears its own history tables
+    for (u64 i = 0; i < this->workers.size(); ++i) {
+        this->workers[i]->run([this, i] () {
+            this->datas[i]->history.clear();
+        });
     }
 
-    for (auto& t : this->threads) {
-        if (!t.joinable()) {
-            continue;
+    this->join();
+};
+
+bool Engine::set(uci::parse::Setoption uci_setoption)
+{
+    this->multipv = uci_setoption.multipv;
+
+    // Quantizing is lossy for weights that don't fit in int8, so turning it off reloads the original net
+    if (uci_setoption.evalfile != this->evalfile || uci_setoption.int8 != this->int8) {
+        this->evalfile = uci_setoption.evalfile;
+        this->int8 = uci_setoption.int8;
+        this->load(this->evalfile);
+    }
+
+    const bool is_numa_changed = uci_setoption.numa != this->numa;
+
+    // Threads are bound when they are spawned, so they are all respawned if the numa mode changes
+    if (is_numa_changed) {
+        this->numa = uci_setoption.numa;
+        this->resize(0);
+    }
+
+    const bool is_eval_cache_changed = uci_setoption.eval_cache != this->eval_cache;
+
+    this->eval_cache = uci_setoption.eval_cache;
+    this->resize(uci_setoption.threads);
+
+    // Each thread allocates its own eval cache
+    if (is_eval_cache_changed) {
+        for (u64 i = 0; i < this->workers.size(); ++i) {
+            this->workers[i]->run([this, i] () {
+                this->datas[i]->cache.init(this->eval_cache);
+            });
         }
 
-        t.join();
+        this->join();
     }
 
-    this->threads.clear();
+    // Only reallocates the table if its size or page type changed
+    const bool is_table_changed =
+        uci_setoption.hash * transposition::MB / sizeof(transposition::Bucket) != this->table.count ||
+        uci_setoption.huge != this->huge;
+
+    if (!is_table_changed && !is_numa_changed) {
+        return false;
+    }
+
+    this->huge = uci_setoption.huge;
+
+    // The table is rebuilt in the background, the next command that needs it waits for the threads
+    // Threads first touch their part of the table
+    const auto mb = is_table_changed ? std::optional<u64>(uci_setoption.hash) : std::nullopt;
+
+    this->workers[0]->run([this, mb] () {
+        this->build_table(mb);
+    });
 
     return true;
 };
 
+// Loads a net file, an empty path or a file that fails to load gives the embedded net
+void Engine::load(const std::string& path)
+{
+    this->stop();
+
+    const u64 time_start = timer::get_current_us();
+
+    auto error = nnue::Error::NONE;
+
+    if (path.empty()) {
+        nnue::init();
+    }
+    else {
+        error = nnue::load(path);
+    }
+
+    if (error != nnue::Error::NONE) {
+        nnue::init();
+    }
+
+    const usize clamped = this->int8 ? nnue::quantize() : 0;
+
+    const u64 time = timer::get_current_us() - time_start;
+
+    // Evals of the old net are still in the table
+    this->table.invalidate();
+
+    if (error != nnue::Error::NONE) {
+        uci::print::info_string("failed to load " + path + ": " + nnue::get_error_name(error) + ", using the embedded net");
+    }
+    else {
+        uci::print::info_string("loaded " + (path.empty() ? std::string("the embedded net") : path) + " " + nnue::get_name() + " in " + std::to_string(time) + " us");
+    }
+
+    if (clamped > 0) {
+        uci::print::info_string(std::to_string(clamped) + " input weights don't fit in int8 and were saturated");
+    }
+};
+
+void Engine::resize(u64 thread_count)
+{
+    this->stop();
+
+    const u64 count_old = this->workers.size();
+
+    // Removed threads are joined and their data freed here
+    this->workers.resize(thread_count);
+    this->datas.resize(thread_count);
+
+    // Spawns new threads, each of them allocates its own search data
+    for (u64 i = count_old; i < thread_count; ++i) {
+        this->workers[i] = std::make_unique<pool::Worker>();
+        this->workers[i]->run([this, i] () {
+            if (this->numa) {
+                numa::bind(i);
+            }
+
+            this->datas[i] = std::make_unique<Data>(Board(), i);
+            this->datas[i]->cache.init(this->eval_cache);
+        });
+    }
+
+    for (u64 i = count_old; i < thread_count; ++i) {
+        this->workers[i]->wait();
+    }
+
+    this->thread_count = thread_count;
+};
+
+bool Engine::stop()
+{
+    // Also ends pondering, so that the best move is sent
+    this->pondering = false;
+    this->running.clear();
+
+    return this->join();
+};
+
+void Engine::ponderhit()
+{
+    // Converts the running search into a timed search, the search itself goes on untouched
+    this->timer.ponderhit();
+    this->pondering = false;
+};
+
+bool Engine::join()
+{
+    bool joined = false;
+
+    for (auto& worker : this->workers) {
+        joined |= worker->wait();
+    }
+
+    return joined;
+};
+
 template <bool BENCH>
 bool Engine::search(Board uci_board, uci::parse::Go uci_go)
 {
-    if (this->running.test() || !this->threads.empty()) {
+    if (this->running.test()) {
         return false;
     }
 
+    // Waits for the threads to finish any background work, like rebuilding the table
+    this->join();
+
     // Updates data
     this->table.update();
     this->timer.set(uci_go, uci_board.get_color());
     this->nodes = 0;
     this->time = 0;
+    this->nnue_update = 0;
+    this->nnue_skip = 0;
+    this->nnue_fused = 0;
+    this->eval_probe = 0;
+    this->eval_hit = 0;
+    this->start = timer::get_current_us();
+    this->started = 0;
+    this->pondering = uci_go.ponder;
 
     // Starts the search thread
     this->running.test_and_set();
 
-    // Starts threads
+    // Wakes up threads
     for (u64 i = 0; i < this->thread_count; ++i) {
-        this->threads.emplace_back([&] (Board board, uci::parse::Go go, u64 id) {
-            // Inits search data
-            auto data = new Data(board, id);
-
-            // Search history
-            std::vector<pv::Line> pv_history = {};
-            i32 score_old = -eval::score::INFINITE;
-
-            // Time scalers
-            i32 pv_stability = 0;
-
-            // Iterative deepening
-            for (i32 i = 1; i < go.depth; ++i) {
-                // Clear search data
-                data->clear();
-
-                // Principle variation search
-                u64 time_1 = timer::get_current();
-                i32 score = this->aspiration_window(*data, i, score_old);
-                u64 time_2 = timer::get_current();
-
-                // Avoids returning false score when stopping early
-                if (!this->running.test()) {
-                    score = score_old;
-                }
-                
-                // Updates score
-                score_old = score;
+        this->workers[i]->run([this, uci_board, uci_go, i] () {
+            this->work<BENCH>(*this->datas[i], uci_board, uci_go);
+        });
+    }
 
-                // Saves pv line
-                if (data->stack[0].pv.count != 0 && data->stack[0].pv[0] != move::NONE) {
-                    pv_history.push_back(data->stack[0].pv);
-                }
+    return true;
+};
+
+template <bool BENCH>
+void Engine::work(Data& data, Board board, uci::parse::Go go)
+{
+    // Measures the time it took for every thread to start searching
+    if (this->started.fetch_add(1) + 1 == this->thread_count) {
+        this->latency = timer::get_current_us() - this->start;
+    }
 
-                // Saves search stats
-                this->nodes += data->nodes;
+    // Inits search data, history tables are kept from the previous search
+    data.board = board;
+    data.nodes_search = 0;
 
-                if (id == 0) {
-                    this->time += time_2 - time_1;
-                }
+    if (tune::HS_DECAY < 1024) {
+        data.history.decay(tune::HS_DECAY);
+    }
+
+    // Search history
+    std::vector<pv::Line> pv_history = {};
+
+    // Generates root moves, ordered by the table move and the history tables for the first iteration
+    data.clear();
+
+    auto [table_hit, table_entry] = this->table.get(board.get_hash());
+
+    data.roots.init(data, table_hit ? table_entry.get_move() : move::NONE, go.searchmoves);
+
+    // Multipv lines, each line searches the root moves that aren't in the lines before it
+    const usize multipv = std::min(data.roots.size(), usize(this->multipv));
+
+    // Time scalers
+    i32 pv_stability = 0;
+    f64 nodes_ratio = 0.0;
+
+    // Iterative deepening
+    for (i32 i = 1; i < go.depth && multipv > 0; ++i) {
+        u64 nodes = 0;
+
+        data.roots.prepare();
+
+        for (usize k = 0; k < multipv; ++k) {
+            // Clear search data
+            data.clear();
+            data.pv_index = k;
+
+            // Principle variation search
+            u64 time_1 = timer::get_current();
+            this->aspiration_window(data, i, data.roots[k].score_previous);
+            u64 time_2 = timer::get_current();
+
+            // Saves search stats
+            nodes += data.nodes;
+            data.nodes_search += data.nodes;
+            this->nodes += data.nodes;
+            this->nnue_update += data.nnue.get_count_update();
+            this->nnue_skip += data.nnue.get_count_skip();
+            this->nnue_fused += data.nnue.get_count_fused();
+            this->eval_probe += data.cache.count_probe;
+            this->eval_hit += data.cache.count_hit;
 
-                // Prints infos
-                if (!BENCH && id == 0) {
-                    uci::print::info(
-                        i,
-                        data->seldepth,
-                        wdl::get_score_normalized(score, wdl::get_material(board)),
-                        data->nodes,
-                        this->nodes.load() * 1000 / std::max(this->time.load(), u64(1)),
-                        this->table.hashfull(),
-                        pv_history.back()
-                    );
-                };
-
-                // Avoids searching too shallow
-                if (i < 4) {
+            if (data.id == 0) {
+                this->time += time_2 - time_1;
+            }
+
+            if (!this->running.test()) {
+                break;
+            }
+        }
+
+        // Orders lines by score, moves that weren't searched again keep their previous order
+        data.roots.sort(0);
+
+        // Time control scaling uses the best move's nodes count
+        nodes_ratio = f64(data.roots[0].nodes) / f64(std::max(nodes, u64(1)));
+
+        // Saves pv line
+        pv_history.push_back(data.roots[0].pv);
+
+        // Prints infos
+        if (!BENCH && data.id == 0) {
+            for (usize k = 0; k < multipv; ++k) {
+                const auto& root_move = data.roots[k];
+
+                // Uses the previous iteration's score for lines that didn't finish
+                const i32 score = root_move.score != -eval::score::INFINITE ? root_move.score : root_move.score_previous;
+
+                if (score == -eval::score::INFINITE) {
                     continue;
                 }
 
-                // Time control scaling
-                // Nodes count
-                f64 nodes_ratio = f64(data->counter.get(data->stack[0].pv[0])) / f64(data->nodes);
-
-                // PV stability
-                if (pv_history.size() > 1) {
-                    if (pv_history[pv_history.size() - 1][0] == pv_history[pv_history.size() - 2][0]) {
-                        pv_stability = std::min(pv_stability + 1, 10);
-                    }
-                    else {
-                        pv_stability = 0;
-                    }
-                }
+                uci::print::info(
+                    i,
+                    root_move.seldepth,
+                    k + 1,
+                    wdl::get_score_normalized(score, wdl::get_material(board)),
+                    nodes,
+                    this->nodes.load() * 1000 / std::max(this->time.load(), u64(1)),
+                    this->table.hashfull(),
+                    root_move.pv
+                );
+            }
+        };
 
-                // Checks time
-                if (id == 0 && !go.infinite && this->timer.is_over_soft(nodes_ratio, pv_stability)) {
-                    this->running.clear();
-                }
+        // Stops when a mate within the requested number of moves is found, a ponder search goes on until ponderhit
+        if (data.id == 0 && !this->pondering && go.mate.has_value() && data.roots[0].score >= eval::score::MATE - go.mate.value() * 2 + 1) {
+            this->running.clear();
+        }
 
-                if (!this->running.test()) {
-                    break;
-                }
+        if (!this->running.test()) {
+            break;
+        }
+
+        // Avoids searching too shallow
+        if (i < 4) {
+            continue;
+        }
+
+        // PV stability
+        if (pv_history.size() > 1) {
+            if (pv_history[pv_history.size() - 1][0] == pv_history[pv_history.size() - 2][0]) {
+                pv_stability = std::min(pv_stability + 1, 10);
             }
+            else {
+                pv_stability = 0;
+            }
+        }
 
-            // Free data
-            delete data;
+        // Checks time
+        if (data.id == 0 && this->timer.is_over_soft(nodes_ratio, pv_stability)) {
+            this->running.clear();
+        }
+
+        if (!this->running.test()) {
+            break;
+        }
+    }
 
-            // Prints best move
-            if (!BENCH && id == 0) {
-                uci::print::best(pv_history.back()[0]);
-            };
-        }, uci_board, uci_go, i);
+    // The best move can't be sent before ponderhit or stop, even if the search itself is over
+    while (data.id == 0 && this->pondering)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
 
-    return true;
+    // Prints best move
+    if (!BENCH && data.id == 0) {
+        uci::print::best(
+            data.roots.size() > 0 ? data.roots[0].move : move::NONE,
+            data.roots.size() > 0 ? this->get_ponder(board, data.roots[0].pv) : move::NONE
+        );
+    };
+};
+
+u16 Engine::get_ponder(Board board, const pv::Line& pv)
+{
+    if (pv.count > 1) {
+        return pv[1];
+    }
+
+    // Falls back to the table move of the position after the best move
+    board.make(pv[0]);
+
+    auto [table_hit, table_entry] = this->table.get(board.get_hash());
+
+    if (table_hit && table_entry.get_move() != move::NONE && board.is_pseudo_legal(table_entry.get_move()) && board.is_legal(table_entry.get_move())) {
+        return table_entry.get_move();
+    }
+
+    return move::NONE;
 };
 
 i32 Engine::aspiration_window(Data& data, i32 depth, i32 score_old)
@@ -186,9 +484,15 @@ i32 Engine::aspiration_window(Data& data, i32 depth, i32 score_old)
     // Loops
     while (true)
     {
+        // Root moves ordered after the killer move are reduced
+        data.roots.set_late(data, data.pv_index);
+
         // Principle variation search
         score = this->pvsearch<node::Type::ROOT>(data, alpha, beta, std::max(depth - reduction, 1), false);
 
+        // Orders the remaining root moves for the next search, the best move goes first
+        data.roots.sort(data.pv_index);
+
         // Aborts
         if (!this->running.test()) {
             break;
@@ -244,6 +548,11 @@ i32 Engine::pvsearch(Data& data, i32 alpha, i32 beta, i32 depth, bool is_cut)
         this->running.clear();
     }
 
+    // Node limits only count the main thread's nodes, so that they are exact with one thread
+    if (data.id == 0 && this->timer.is_over_nodes(data.nodes_search + data.nodes)) {
+        this->running.clear();
+    }
+
     if (!this->running.test()) {
         return eval::score::DRAW;
     }
@@ -253,7 +562,7 @@ i32 Engine::pvsearch(Data& data, i32 alpha, i32 beta, i32 depth, bool is_cut)
 
     // Max ply reached
     if (data.ply >= MAX_PLY) {
-        return is_in_check ? eval::score::DRAW : eval::get(data.board, data.nnue);
+        return is_in_check ? eval::score::DRAW : eval::get(data.board, data.nnue, data.cache);
     }
 
     // Updates stat
@@ -290,12 +599,12 @@ i32 Engine::pvsearch(Data& data, i32 alpha, i32 beta, i32 depth, bool is_cut)
     auto table_pv = is_pv;
 
     if (table_hit) {
-        table_move = table_entry->get_move();
-        table_eval = table_entry->get_eval();
-        table_score = table_entry->get_score(data.ply);
-        table_depth = table_entry->get_depth();
-        table_bound = table_entry->get_bound();
-        table_pv |= table_entry->is_pv();
+        table_move = table_entry.get_move();
+        table_eval = table_entry.get_eval();
+        table_score = table_entry.get_score(data.ply);
+        table_depth = table_entry.get_depth();
+        table_bound = table_entry.get_bound();
+        table_pv |= table_entry.is_pv();
 
         // Cutoff
         if (!is_pv && !is_singular && table_score != eval::score::NONE && table_depth >= depth && data.board.get_halfmove_count() < 90) {
@@ -329,7 +638,7 @@ i32 Engine::pvsearch(Data& data, i32 alpha, i32 beta, i32 depth, bool is_cut)
         eval_static = data.stack[data.ply].eval;
     }
     else {
-        eval_raw = table_eval != eval::score::NONE ? table_eval : eval::get(data.board, data.nnue);
+        eval_raw = table_eval != eval::score::NONE ? table_eval : eval::get(data.board, data.nnue, data.cache);
         eval_static = eval::get_adjusted(eval_raw, data.history.get_correction(data.board), data.board.get_halfmove_count());
         eval = eval_static;
 
@@ -343,7 +652,7 @@ i32 Engine::pvsearch(Data& data, i32 alpha, i32 beta, i32 depth, bool is_cut)
         }
         else {
             // Stores this eval into the table
-            table_entry->set(
+            table_entry.set(
                 data.board.get_hash(),
                 move::NONE,
                 eval::score::NONE,
@@ -448,17 +757,31 @@ i32 Engine::pvsearch(Data& data, i32 alpha, i32 beta, i32 depth, bool is_cut)
     u16 best_move = move::NONE;
     i32 alpha_old = alpha;
 
-    // Generates moves
-    auto picker = order::Picker(data, table_move);
+    // Generates moves, the root takes its moves from the root list and needs no picker
+    auto picker = std::optional<order::Picker>();
+
+    if constexpr (!is_root) {
+        picker.emplace(data, table_move);
+    }
+
     auto legals = 0;
     auto quiets = arrayvec<u16, move::MAX>();
     auto noisies = arrayvec<u16, move::MAX>();
+    auto root_index = data.pv_index;
 
     // Iterates moves
     while (true)
     {
-        // Gets move
-        const u16 move = picker.get(data);
+        // Gets move, root moves are taken from the root list in their current order
+        u16 move = move::NONE;
+
+        if constexpr (is_root) {
+            move = root_index < data.roots.size() ? data.roots[root_index].move : move::NONE;
+            root_index += 1;
+        }
+        else {
+            move = picker->get(data);
+        }
 
         if (!move) {
             break;
@@ -479,6 +802,9 @@ i32 Engine::pvsearch(Data& data, i32 alpha, i32 beta, i32 depth, bool is_cut)
         // Checks for quiet
         const bool is_quiet = data.board.is_quiet(move);
 
+        // Checks if this move was ordered after the killer move
+        const bool is_late = is_root ? data.roots[root_index - 1].is_late : picker->get_stage() > order::Stage::KILLER;
+
         data.stack[data.ply].is_quiet = is_quiet;
 
         // Gets history score
@@ -501,9 +827,9 @@ i32 Engine::pvsearch(Data& data, i32 alpha, i32 beta, i32 depth, bool is_cut)
         // Pruning
         if (!is_root && best > -eval::score::MATE_FOUND) {
             // Late move pruning
-            if (!picker.is_skipped() &&
+            if (!picker->is_skipped() &&
                 legals >= (depth * depth + tune::LMP_BASE) / (2 - is_improving)) {
-                picker.skip_quiets();
+                picker->skip_quiets();
             }
 
             // Gets reduced depth
@@ -512,7 +838,7 @@ i32 Engine::pvsearch(Data& data, i32 alpha, i32 beta, i32 depth, bool is_cut)
             // Futility pruning
             const i32 futility = eval_static + depth_reduced * tune::FP_COEF + tune::FP_BIAS;
 
-            if (!picker.is_skipped() &&
+            if (!picker->is_skipped() &&
                 !is_in_check &&
                 is_quiet &&
                 depth_reduced <= tune::FP_DEPTH &&
@@ -522,7 +848,7 @@ i32 Engine::pvsearch(Data& data, i32 alpha, i32 beta, i32 depth, bool is_cut)
                     best = futility;
                 }
                     
-                picker.skip_quiets();
+                picker->skip_quiets();
                 continue;
             }
 
@@ -532,7 +858,7 @@ i32 Engine::pvsearch(Data& data, i32 alpha, i32 beta, i32 depth, bool is_cut)
                 tune::SEEP_MARGIN_QUIET * depth_reduced :
                 tune::SEEP_MARGIN_NOISY * depth_reduced * depth_reduced;
             
-            if (picker.get_stage() > order::Stage::KILLER && !see::is_ok(data.board, move, see_margin)) {
+            if (picker->get_stage() > order::Stage::KILLER && !see::is_ok(data.board, move, see_margin)) {
                 continue;
             }
         }
@@ -608,7 +934,7 @@ i32 Engine::pvsearch(Data& data, i32 alpha, i32 beta, i32 depth, bool is_cut)
         // Late move reduction
         if (legals > 1 + is_root * 2 &&
             depth >= tune::LMR_DEPTH &&
-            picker.get_stage() > order::Stage::KILLER) {
+            is_late) {
             // Updates reduction
             reduction -= table_pv;
             reduction -= data.board.get_checkers() != 0ULL;
@@ -659,9 +985,16 @@ i32 Engine::pvsearch(Data& data, i32 alpha, i32 beta, i32 depth, bool is_cut)
             return eval::score::DRAW;
         }
 
-        // Set root moves' nodes count
+        // Updates root move stats, moves that fail low are ordered after the best move
         if constexpr (is_root) {
-            data.counter.set(move, data.nodes - nodes_start);
+            data.roots[root_index - 1].nodes += data.nodes - nodes_start;
+
+            if (legals == 1 || score > alpha) {
+                data.roots.update(root_index - 1, score, data.seldepth, data.stack[data.ply + 1].pv);
+            }
+            else {
+                data.roots[root_index - 1].score = -eval::score::INFINITE;
+            }
         }
 
         // Updates best
@@ -769,7 +1102,7 @@ i32 Engine::pvsearch(Data& data, i32 alpha, i32 beta, i32 depth, bool is_cut)
 
     // Updates transposition table
     if (!is_singular) {
-        table_entry->set(
+        table_entry.set(
             data.board.get_hash(),
             best_move,
             best,
@@ -796,6 +1129,11 @@ i32 Engine::qsearch(Data& data, i32 alpha, i32 beta)
         this->running.clear();
     }
 
+    // Node limits only count the main thread's nodes, so that they are exact with one thread
+    if (data.id == 0 && this->timer.is_over_nodes(data.nodes_search + data.nodes)) {
+        this->running.clear();
+    }
+
     if (!this->running.test()) {
         return eval::score::DRAW;
     }
@@ -805,7 +1143,7 @@ i32 Engine::qsearch(Data& data, i32 alpha, i32 beta)
 
     // Max ply reached
     if (data.ply >= MAX_PLY) {
-        return is_in_check ? eval::score::DRAW : eval::get(data.board, data.nnue);
+        return is_in_check ? eval::score::DRAW : eval::get(data.board, data.nnue, data.cache);
     }
 
     // Updates stat
@@ -827,11 +1165,11 @@ i32 Engine::qsearch(Data& data, i32 alpha, i32 beta)
     auto table_pv = PV;
 
     if (table_hit) {
-        table_move = table_entry->get_move();
-        table_eval = table_entry->get_eval();
-        table_score = table_entry->get_score(data.ply);
-        table_bound = table_entry->get_bound();
-        table_pv |= table_entry->is_pv();
+        table_move = table_entry.get_move();
+        table_eval = table_entry.get_eval();
+        table_score = table_entry.get_score(data.ply);
+        table_bound = table_entry.get_bound();
+        table_pv |= table_entry.is_pv();
 
         // Cut off
         if (!PV && table_score != eval::score::NONE) {
@@ -849,7 +1187,7 @@ i32 Engine::qsearch(Data& data, i32 alpha, i32 beta)
     i32 eval_static = eval::score::NONE;
 
     if (!is_in_check) {
-        eval_raw = table_eval != eval::score::NONE ? table_eval : eval::get(data.board, data.nnue);
+        eval_raw = table_eval != eval::score::NONE ? table_eval : eval::get(data.board, data.nnue, data.cache);
         eval_static = eval::get_adjusted(eval_raw, data.history.get_correction(data.board), data.board.get_halfmove_count());
         eval = eval_static;
 
@@ -863,7 +1201,7 @@ i32 Engine::qsearch(Data& data, i32 alpha, i32 beta)
         }
         else {
             // Stores this eval into the table
-            table_entry->set(
+            table_entry.set(
                 data.board.get_hash(),
                 move::NONE,
                 eval::score::NONE,
@@ -997,7 +1335,7 @@ i32 Engine::qsearch(Data& data, i32 alpha, i32 beta)
         best > alpha_old ? transposition::bound::EXACT :
         transposition::bound::UPPER;
 
-    table_entry->set(
+    table_entry.set(
         data.board.get_hash(),
         best_move,
         best,
@@ -1015,6 +1353,9 @@ i32 Engine::qsearch(Data& data, i32 alpha, i32 beta)
 template bool Engine::search<true>(Board, uci::parse::Go);
 template bool Engine::search<false>(Board, uci::parse::Go);
 
+template void Engine::work<true>(Data&, Board, uci::parse::Go);
+template void Engine::work<false>(Data&, Board, uci::parse::Go);
+
 template i32 Engine::pvsearch<node::Type::ROOT>(Data&, i32, i32, i32, bool);
 template i32 Engine::pvsearch<node::Type::PV>(Data&, i32, i32, i32, bool);
 template i32 Engine::pvsearch<node::Type::NORMAL>(Data&, i32, i32, i32, bool);
@@ -1024,6 +1365,7 @@ template i32 Engine::qsearch<false>(Data&, i32, i32);
 
 void init()
 {
+    numa::init();
     tune::init();
     nnue::init();
 };
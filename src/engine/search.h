@@ -8,6 +8,7 @@
 #include "node.h"
 #include "see.h"
 #include "wdl.h"
+#include "pool.h"
 
 namespace search
 {
@@ -16,22 +17,48 @@ class Engine
 {
 public:
     std::atomic_flag running;
-    std::vector<std::thread> threads;
+    std::atomic<bool> pondering;
+    std::vector<std::unique_ptr<pool::Worker>> workers;
+    std::vector<std::unique_ptr<Data>> datas;
     u64 thread_count;
+    bool numa;
+    bool huge;
+    u64 multipv;
+    std::string evalfile;
+    bool int8;
+    u64 eval_cache;
 public:
     timer::Data timer;
     transposition::Table table;
 public:
     std::atomic<u64> nodes;
     std::atomic<u64> time;
+    std::atomic<u64> nnue_update;
+    std::atomic<u64> nnue_skip;
+    std::atomic<u64> nnue_fused;
+    std::atomic<u64> eval_probe;
+    std::atomic<u64> eval_hit;
+public:
+    u64 start;
+    std::atomic<u64> started;
+    std::atomic<u64> latency;
 public:
     Engine();
+    ~Engine();
 public:
-    void clear();
-    void set(uci::parse::Setoption uci_setoption);
+    void clear(bool lazy = false);
+    void clear_table();
+    void build_table(std::optional<u64> mb);
+    void clear_history();
+    bool set(uci::parse::Setoption uci_setoption);
+    void load(const std::string& path);
+    void resize(u64 thread_count);
     bool stop();
     bool join();
+    void ponderhit();
     template <bool BENCH> bool search(Board uci_board, uci::parse::Go uci_go);
+    template <bool BENCH> void work(Data& data, Board board, uci::parse::Go go);
+    u16 get_ponder(Board board, const pv::Line& pv);
 public:
     i32 aspiration_window(Data& data, i32 depth, i32 score_old);
     template <node::Type NODE> i32 pvsearch(Data& data, i32 alpha, i32 beta, i32 depth, bool is_cut);
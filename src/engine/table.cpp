@@ -3,6 +3,14 @@
 namespace transposition
 {
 
+Entry::Entry(Bucket* bucket, usize index, u16 salt)
+{
+    this->bucket = bucket;
+    this->index = index;
+    this->salt = salt;
+    this->load();
+};
+
 u16 Entry::get_hash()
 {
     return this->hash;
@@ -78,6 +86,9 @@ void Entry::set_score(i32 score, i32 ply)
 
 void Entry::set(u64 hash, u16 move, i32 score, i32 eval, i32 depth, u8 age, bool pv, u8 bound, i32 ply)
 {
+    // Another thread may have written to this slot since we read it
+    this->load();
+
     // Preserves any existing move for the same position
     if (move || this->hash != static_cast<u16>(hash)) {
         this->move = move;
@@ -94,6 +105,35 @@ void Entry::set(u64 hash, u16 move, i32 score, i32 eval, i32 depth, u8 age, bool
         this->eval = eval;
         this->flags = (age << 3) | (u8(pv) << 2) | bound;
     }
+
+    this->store();
+};
+
+void Entry::load()
+{
+    // Each word is read atomically, but the key and the data may still come from different writes
+    const u64 data = std::atomic_ref<u64>(this->bucket->data[this->index]).load(std::memory_order_relaxed);
+    const u16 key = std::atomic_ref<u16>(this->bucket->keys[this->index]).load(std::memory_order_relaxed);
+
+    this->hash = key ^ get_fold(data) ^ this->salt;
+    this->move = static_cast<u16>(data);
+    this->score = static_cast<i16>(data >> 16);
+    this->eval = static_cast<i16>(data >> 32);
+    this->depth = static_cast<u8>(data >> 48);
+    this->flags = static_cast<u8>(data >> 56);
+};
+
+void Entry::store()
+{
+    const u64 data =
+        u64(this->move) |
+        (u64(u16(this->score)) << 16) |
+        (u64(u16(this->eval)) << 32) |
+        (u64(this->depth) << 48) |
+        (u64(this->flags) << 56);
+
+    std::atomic_ref<u64>(this->bucket->data[this->index]).store(data, std::memory_order_relaxed);
+    std::atomic_ref<u16>(this->bucket->keys[this->index]).store(this->hash ^ get_fold(data) ^ this->salt, std::memory_order_relaxed);
 };
 
 Table::Table()
@@ -101,90 +141,97 @@ Table::Table()
     this->buckets = nullptr;
     this->count = 0;
     this->age = 0;
+    this->salt = 0;
+    this->page = Page::NORMAL;
+    this->time_init = 0;
+    this->time_clear = 0;
 };
 
 Table::~Table()
 {
     if (this->buckets != nullptr) {
-        free_aligned(this->buckets);
+        free_huge(this->buckets, this->count * sizeof(Bucket), this->page);
     }
 };
 
-void Table::init(u64 mb)
+void Table::init(u64 mb, bool huge)
 {
+    const u64 time_start = timer::get_current();
+
     // Free memory if there is any
     if (this->buckets != nullptr) {
-        free_aligned(this->buckets);
+        free_huge(this->buckets, this->count * sizeof(Bucket), this->page);
     }
 
     // Sets count
     this->count = mb * MB / sizeof(Bucket);
     
     // Alloc memory
-    #if defined(__linux__)
-    u64 alignment = 2 * MB;
-    #else
-    u64 alignment = 4 * KB;
-    #endif
-
-    this->buckets = static_cast<Bucket*>(malloc_aligned(alignment, mb * MB));
+    this->buckets = static_cast<Bucket*>(malloc_huge(mb * MB, huge, this->page));
 
     this->age = 0;
+    this->salt = 0;
+
+    this->time_init = timer::get_current() - time_start;
 };
 
-void Table::clear(usize thread_count)
+// Clears one of the parts of the table, so that threads can clear it together
+void Table::clear(usize index, usize parts)
 {
     if (this->buckets == nullptr) {
         return;
     }
 
-    const u64 chunk = this->count / thread_count;
-
-    std::vector<std::thread> threads;
+    const u64 chunk = this->count / parts;
+    const u64 begin = chunk * index;
+    const u64 end = index + 1 == parts ? this->count : begin + chunk;
 
-    for (usize i = 0; i < thread_count; ++i) {
-        threads.emplace_back([&] (usize thread_id) {
-            std::memset((void*)&this->buckets[chunk * thread_id], 0, chunk * sizeof(Bucket));
-        }, i);
-    }
-
-    if (chunk * thread_count < this->count) {
-        std::memset((void*)&this->buckets[chunk * thread_count], 0, (this->count - chunk * thread_count) * sizeof(Bucket));
-    }
+    std::memset((void*)&this->buckets[begin], 0, (end - begin) * sizeof(Bucket));
 
-    for (auto& t : threads) {
-        t.join();
+    if (index == 0) {
+        this->age = 0;
+        this->salt = 0;
     }
+};
 
-    this->age = 0;
+// Invalidates every entry without touching the memory
+// Old entries now fail the hash check and look old to the replacement scheme
+void Table::invalidate()
+{
+    this->salt += 0x9E37;
+    this->update();
 };
 
-std::pair<bool, Entry*> Table::get(u64 hash)
+std::pair<bool, Entry> Table::get(u64 hash)
 {
     const u64 index = this->get_index(hash);
 
     assert(index < this->count);
 
-    auto entries = this->buckets[index].entries;
+    auto bucket = &this->buckets[index];
+
+    Entry entries[MAX_ENTRIES];
 
     // Finds matching entry
     for (usize i = 0; i < MAX_ENTRIES; ++i) {
+        entries[i] = Entry(bucket, i, this->salt);
+
         if (entries[i].get_hash() == static_cast<u16>(hash)) {
-            return { true, &entries[i] };
+            return { true, entries[i] };
         }
     }
 
     // Finds replacement
-    auto entry = &entries[0];
+    usize replace = 0;
 
     for (usize i = 1; i < MAX_ENTRIES; ++i) {
         if (entries[i].get_depth() - 4 * entries[i].get_age_distance(this->age) <
-            entry->get_depth() - 4 * entry->get_age_distance(this->age)) {
-            entry = &entries[i];
+            entries[replace].get_depth() - 4 * entries[replace].get_age_distance(this->age)) {
+            replace = i;
         }
     }
 
-    return { false, entry };
+    return { false, entries[replace] };
 };
 
 u64 Table::get_index(u64 hash)
@@ -208,8 +255,9 @@ usize Table::hashfull()
 
     for (usize i = 0; i < 1000; ++i) {
         for (usize k = 0; k < MAX_ENTRIES; ++k) {
-            if (this->buckets[i].entries[k].get_age() == this->age &&
-                this->buckets[i].entries[k].get_hash() != 0) {
+            auto entry = Entry(&this->buckets[i], k, this->salt);
+
+            if (entry.get_age() == this->age && entry.get_hash() != 0) {
                 count += 1;
             }
         }
@@ -1,11 +1,14 @@
 #pragma once
 
 #include <thread>
+#include <atomic>
 #include <climits>
 #include <cstring>
 
 #include "../util/alloc.h"
+#include "../util/numa.h"
 #include "eval.h"
+#include "timer.h"
 
 namespace transposition
 {
@@ -35,6 +38,13 @@ constexpr u8 MAX_AGE = 1 << std::popcount(mask::AGE);
 constexpr u64 KB = 1ULL << 10;
 constexpr u64 MB = 1ULL << 20;
 
+struct Bucket;
+
+// A copy of an entry read from the table
+// Entries are stored as a packed 64-bit data word and a 16-bit key, where the key is
+// the hash xored with the folded data, so that reading a key and data from two different
+// writes fails the hash check instead of returning a torn entry
+// The key is also xored with the table's salt, so changing the salt invalidates every entry
 class Entry
 {
 private:
@@ -44,6 +54,13 @@ private:
     i16 eval = 0;
     u8 depth = 0;
     u8 flags = 0; // age : 5, pv : 1, bound : 2
+private:
+    Bucket* bucket = nullptr;
+    usize index = 0;
+    u16 salt = 0;
+public:
+    Entry() = default;
+    Entry(Bucket* bucket, usize index, u16 salt);
 public:
     u16 get_hash();
     u16 get_move();
@@ -57,11 +74,20 @@ public:
 public:
     void set_score(i32 score, i32 ply);
     void set(u64 hash, u16 move, i32 score, i32 eval, i32 depth, u8 age, bool pv, u8 bound, i32 ply);
+public:
+    void load();
+    void store();
 };
 
 struct alignas(32) Bucket
 {
-    Entry entries[MAX_ENTRIES];
+    u64 data[MAX_ENTRIES];
+    u16 keys[MAX_ENTRIES];
+};
+
+inline u16 get_fold(u64 data)
+{
+    return static_cast<u16>(data ^ (data >> 16) ^ (data >> 32) ^ (data >> 48));
 };
 
 class Table
@@ -70,14 +96,20 @@ public:
     Bucket* buckets;
     u64 count;
     u8 age;
+    u16 salt;
+public:
+    Page page;
+    u64 time_init;
+    u64 time_clear;
 public:
     Table();
     ~Table();
 public:
-    void init(u64 mb);
-    void clear(usize thread_count = 1);
+    void init(u64 mb, bool huge = false);
+    void clear(usize index = 0, usize parts = 1);
+    void invalidate();
 public:
-    std::pair<bool, Entry*> get(u64 hash);
+    std::pair<bool, Entry> get(u64 hash);
     u64 get_index(u64 hash);
 public:
     void update();
@@ -85,7 +117,6 @@ public:
     usize hashfull();
 };
 
-static_assert(sizeof(Entry) == 10);
 static_assert(sizeof(Bucket) == 32);
 
 };
\ No newline at end of file
@@ -10,14 +10,27 @@ Data::Data()
 
 void Data::set(uci::parse::Go go, i8 color)
 {
+    this->go = go;
+    this->color = color;
+
+    // Sets the start time before the limits, so that a thread reading a new limit also reads the new start time
     this->start = timer::get_current();
     this->limit_soft = this->start + timer::get_available_soft(go.time[color], go.increment[color], go.movestogo);
     this->limit_hard = this->start + timer::get_available_hard(go.time[color]);
 
-    if (go.infinite) {
+    if (go.infinite || go.ponder) {
         this->limit_soft = UINT64_MAX;
         this->limit_hard = UINT64_MAX;
     }
+
+    // Fixed time searches use all of their time
+    if (go.movetime.has_value() && !go.ponder) {
+        this->limit_soft = UINT64_MAX;
+        this->limit_hard = this->start + go.movetime.value();
+    }
+
+    // Pondering has no node limit either, ponderhit sets it
+    this->limit_nodes = go.ponder ? UINT64_MAX : go.nodes.value_or(UINT64_MAX);
 };
 
 void Data::clear()
@@ -25,11 +38,30 @@ void Data::clear()
     this->start = 0;
     this->limit_soft = UINT64_MAX;
     this->limit_hard = UINT64_MAX;
+    this->limit_nodes = UINT64_MAX;
+    this->go = uci::parse::Go();
+    this->color = color::WHITE;
+};
+
+// Our clock starts running when the opponent plays the expected move
+void Data::ponderhit()
+{
+    auto go = this->go;
+
+    go.ponder = false;
+
+    this->set(go, this->color);
 };
 
 bool Data::is_over_soft(f64 nodes_ratio, i32 pv_stability)
 {
-    f64 remain = this->limit_soft - this->start;
+    const u64 limit = this->limit_soft;
+
+    if (limit == UINT64_MAX) {
+        return false;
+    }
+
+    f64 remain = limit - this->start;
 
     remain *= 2.0 - 1.5 * nodes_ratio;
     remain *= 1.25 - 0.05 * f64(pv_stability);
@@ -42,4 +74,9 @@ bool Data::is_over_hard()
     return timer::get_current() >= this->limit_hard;
 };
 
+bool Data::is_over_nodes(u64 nodes)
+{
+    return nodes >= this->limit_nodes;
+};
+
 };
\ No newline at end of file
@@ -1,24 +1,33 @@
 #pragma once
 
+#include <atomic>
+
 #include "uci.h"
 
 namespace timer
 {
 
+// Limits are atomic since ponderhit updates them while the search threads read them
 class Data
 {
 public:
-    u64 start;
-    u64 limit_soft;
-    u64 limit_hard;
+    std::atomic<u64> start;
+    std::atomic<u64> limit_soft;
+    std::atomic<u64> limit_hard;
+    std::atomic<u64> limit_nodes;
+public:
+    uci::parse::Go go;
+    i8 color;
 public:
     Data();
 public:
     void set(uci::parse::Go go, i8 color);
     void clear();
+    void ponderhit();
 public:
     bool is_over_soft(f64 nodes_ratio, i32 pv_stability);
     bool is_over_hard();
+    bool is_over_nodes(u64 nodes);
 };
 
 inline u64 get_current()
@@ -26,6 +35,16 @@ inline u64 get_current()
     return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
 };
 
+inline u64 get_current_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+};
+
+inline u64 get_current_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+};
+
 inline u64 get_available_soft(u64 remain, u64 increment, std::optional<u64> movestogo = {})
 {
     u64 mtg = movestogo.value_or(45) + 5;
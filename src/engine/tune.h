@@ -82,6 +82,8 @@ VALUE(HS_MALUS_COEF, 150, 50, 500, 10, false)
 VALUE(HS_MALUS_BIAS, -50, -250, 0, 5, false)
 VALUE(HS_MALUS_MAX, 1000, 500, 2500, 50, false)
 
+VALUE(HS_DECAY, 1024, 512, 1024, 32, false)
+
 VALUE(CORR_WEIGHT_PAWN, 64, 16, 128, 8, false)
 VALUE(CORR_WEIGHT_NON_PAWN, 32, 16, 128, 8, false)
 VALUE(CORR_WEIGHT_MINOR, 32, 16, 128, 8, false)
@@ -90,7 +90,7 @@ std::optional<Board> position(std::string in)
     return board;
 };
 
-std::optional<Go> go(std::string in)
+std::optional<Go> go(std::string in, Board board)
 {
     auto option = Go {
         .depth = MAX_PLY,
@@ -114,6 +114,10 @@ std::optional<Go> go(std::string in)
             option.infinite = true;
         }
 
+        if (tokens[i] == "ponder") {
+            option.ponder = true;
+        }
+
         if (tokens[i] == "winc") {
             option.increment[color::WHITE] = std::max(std::stoi(tokens[i + 1]), 0);
         }
@@ -134,21 +138,46 @@ std::optional<Go> go(std::string in)
 
         if (tokens[i] == "depth") {
             option.depth = std::max(std::stoi(tokens[i + 1]), 1);
-            option.infinite = false;
         }
 
         if (tokens[i] == "movestogo") {
             option.movestogo = std::max(std::stoi(tokens[i + 1]), 1);
         }
+
+        if (tokens[i] == "nodes") {
+            option.nodes = std::max(std::stoll(tokens[i + 1]), 1LL);
+        }
+
+        if (tokens[i] == "movetime") {
+            option.movetime = std::max(std::stoll(tokens[i + 1]), 1LL);
+            option.infinite = false;
+        }
+
+        if (tokens[i] == "mate") {
+            option.mate = std::max(std::stoi(tokens[i + 1]), 1);
+        }
+
+        // Reads moves until the next token that isn't a legal move
+        if (tokens[i] == "searchmoves") {
+            while (i + 1 < tokens.size())
+            {
+                auto move = uci::parse::move(tokens[i + 1], board);
+
+                if (!move.has_value()) {
+                    break;
+                }
+
+                option.searchmoves.push_back(move.value());
+                i += 1;
+            }
+        }
     }
 
     return option;
 };
 
-std::optional<Setoption> setoption(std::string in)
+std::optional<Setoption> setoption(std::string in, Setoption option)
 {
-    auto option = Setoption();
-
     std::stringstream ss(in);
     std::string token;
     std::vector<std::string> tokens;
@@ -170,6 +199,43 @@ std::optional<Setoption> setoption(std::string in)
         option.threads = std::clamp(std::stoi(tokens[4]), i32(THREAD_MIN), i32(THREAD_MAX));
     }
 
+    if (tokens[2] == "MultiPV") {
+        option.multipv = std::clamp(std::stoi(tokens[4]), i32(MULTIPV_MIN), i32(MULTIPV_MAX));
+    }
+
+    if (tokens[2] == "NUMA") {
+        option.numa = tokens[4] == "true";
+    }
+
+    if (tokens[2] == "HugePages") {
+        option.huge = tokens[4] == "true";
+    }
+
+    if (tokens[2] == "Ponder") {
+        option.ponder = tokens[4] == "true";
+    }
+
+    // Paths may contain spaces, an empty path is the embedded net
+    if (tokens[2] == "EvalFile") {
+        option.evalfile = tokens[4];
+
+        for (usize i = 5; i < tokens.size(); ++i) {
+            option.evalfile += " " + tokens[i];
+        }
+
+        if (option.evalfile == "<empty>") {
+            option.evalfile = "";
+        }
+    }
+
+    if (tokens[2] == "EvalCache") {
+        option.eval_cache = std::clamp(std::stoi(tokens[4]), i32(EVAL_CACHE_MIN), i32(EVAL_CACHE_MAX));
+    }
+
+    if (tokens[2] == "Int8Weights") {
+        option.int8 = tokens[4] == "true";
+    }
+
     if constexpr (tune::TUNING) {
         auto value = tune::find(tokens[2]);
 
@@ -192,6 +258,14 @@ void option()
 {
     std::cout << "option name Hash type spin default " << HASH_DEFAULT << " min " << HASH_MIN << " max " << HASH_MAX << std::endl;
     std::cout << "option name Threads type spin default " << THREAD_DEFAULT << " min " << THREAD_MIN << " max " << THREAD_MAX << std::endl;
+    std::cout << "option name MultiPV type spin default " << MULTIPV_DEFAULT << " min " << MULTIPV_MIN << " max " << MULTIPV_MAX << std::endl;
+    std::cout << "option name NUMA type check default false" << std::endl;
+    std::cout << "option name HugePages type check default false" << std::endl;
+    std::cout << "option name Ponder type check default false" << std::endl;
+    std::cout << "option name EvalFile type string default <empty>" << std::endl;
+    std::cout << "option name Int8Weights type check default false" << std::endl;
+    std::cout << "option name EvalCache type spin default " << EVAL_CACHE_DEFAULT << " min " << EVAL_CACHE_MIN << " max " << EVAL_CACHE_MAX << std::endl;
+    std::cout << "option name Clear Hash type button" << std::endl;
 
     if constexpr (!tune::TUNING) {
         return;
@@ -202,7 +276,7 @@ void option()
     }
 };
 
-void info(i32 depth, i32 seldepth, i32 score, u64 nodes, u64 nps, u64 hashfull, pv::Line pv)
+void info(i32 depth, i32 seldepth, usize multipv, i32 score, u64 nodes, u64 nps, u64 hashfull, pv::Line pv)
 {
     std::cout << "info ";
 
@@ -210,8 +284,10 @@ void info(i32 depth, i32 seldepth, i32 score, u64 nodes, u64 nps, u64 hashfull,
 
     std::cout << "seldepth " << seldepth << " ";
 
+    std::cout << "multipv " << multipv << " ";
+
     if (score >= eval::score::MATE_FOUND) {
-        std::cout << "score mate " << ((eval::score::MATE - score) / 2) << " ";
+        std::cout << "score mate " << ((eval::score::MATE - score + 1) / 2) << " ";
     }
     else if (score <= -eval::score::MATE_FOUND) {
         std::cout << "score mate " << ((-eval::score::MATE - score) / 2) << " ";
@@ -235,9 +311,29 @@ void info(i32 depth, i32 seldepth, i32 score, u64 nodes, u64 nps, u64 hashfull,
     std::cout << std::endl;
 };
 
-void best(u16 move)
+void best(u16 move, u16 ponder)
+{
+    std::cout << "bestmove " << (move != move::NONE ? move::get_str(move) : "0000");
+
+    if (ponder != move::NONE) {
+        std::cout << " ponder " << move::get_str(ponder);
+    }
+
+    std::cout << std::endl;
+};
+
+void info_string(const std::string& str)
+{
+    std::cout << "info string " << str << std::endl;
+};
+
+void hash(u64 mb, Page page, u64 time_init, u64 time_clear)
 {
-    std::cout << "bestmove " << move::get_str(move) << std::endl;
+    info_string(
+        "hash " + std::to_string(mb) + " MB using " + get_page_name(page) +
+        ", allocated in " + std::to_string(time_init) + " ms" +
+        ", cleared in " + std::to_string(time_clear) + " ms"
+    );
 };
 
 };
\ No newline at end of file
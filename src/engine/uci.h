@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../util/alloc.h"
 #include "pv.h"
 #include "eval.h"
 #include "tune.h"
@@ -15,6 +16,15 @@ constexpr u64 THREAD_DEFAULT = 1ULL;
 constexpr u64 THREAD_MIN = 1ULL;
 constexpr u64 THREAD_MAX = 1ULL << 8;
 
+constexpr u64 MULTIPV_DEFAULT = 1ULL;
+constexpr u64 MULTIPV_MIN = 1ULL;
+constexpr u64 MULTIPV_MAX = move::MAX;
+
+// Size of each thread's eval cache in KB, it's off by default since the table already keeps the evals of most positions
+constexpr u64 EVAL_CACHE_DEFAULT = 0ULL;
+constexpr u64 EVAL_CACHE_MIN = 0ULL;
+constexpr u64 EVAL_CACHE_MAX = 1ULL << 16;
+
 };
 
 namespace uci::parse
@@ -24,6 +34,13 @@ struct Setoption
 {
     u64 hash = HASH_DEFAULT;
     u64 threads = THREAD_DEFAULT;
+    bool numa = false;
+    bool huge = false;
+    u64 multipv = MULTIPV_DEFAULT;
+    bool ponder = false;
+    std::string evalfile = "";
+    bool int8 = false;
+    u64 eval_cache = EVAL_CACHE_DEFAULT;
 };
 
 struct Go
@@ -33,15 +50,20 @@ struct Go
     u64 increment[2];
     std::optional<i32> movestogo;
     bool infinite;
+    std::optional<u64> nodes = {};
+    std::optional<u64> movetime = {};
+    std::optional<i32> mate = {};
+    std::vector<u16> searchmoves = {};
+    bool ponder = false;
 };
 
 std::optional<u16> move(const std::string& token, Board& board);
 
 std::optional<Board> position(std::string in);
 
-std::optional<Go> go(std::string in);
+std::optional<Go> go(std::string in, Board board = Board());
 
-std::optional<Setoption> setoption(std::string in);
+std::optional<Setoption> setoption(std::string in, Setoption option = Setoption());
 
 };
 
@@ -50,8 +72,12 @@ namespace uci::print
 
 void option();
 
-void info(i32 depth, i32 seldepth, i32 score, u64 nodes, u64 time, u64 hashfull, pv::Line pv);
+void info(i32 depth, i32 seldepth, usize multipv, i32 score, u64 nodes, u64 time, u64 hashfull, pv::Line pv);
+
+void best(u16 move, u16 ponder = move::NONE);
+
+void info_string(const std::string& str);
 
-void best(u16 move);
+void hash(u64 mb, Page page, u64 time_init, u64 time_clear);
 
 };
\ No newline at end of file
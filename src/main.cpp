@@ -1,26 +1,166 @@
 #include "engine/search.h"
 #include "test/test.h"
 #include "datagen/datagen.h"
+#include "datagen/batch.h"
 
 int main(int argc, char* argv[])
 {
     chess::init();
     search::init();
 
+    // Settings are name value pairs, see datagen/config.h, like threads 32 nodes 5000 book openings.epd time 3600
     if constexpr (datagen::GENERATING) {
-        u64 thread_count = 4;
+        const auto config = datagen::config::parse({ argv + 1, argv + argc });
 
-        if (argc > 1) {
-            thread_count = std::stoull(argv[1]);
+        if (!config.has_value()) {
+            std::cout << "usage: datagen [threads n] [output positions|games] [depth n] [nodes n] [book path] [random n] [opening_delta n] ";
+            std::cout << "[win_score n] [win_plies n] [draw_score n] [draw_plies n] [draw_ply n] [visit n] [positions n] [time s]" << std::endl;
+            return 1;
         }
 
-        datagen::run(thread_count);
+        return datagen::run(config.value()) ? 0 : 1;
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "test") {
+        test::test();
+        return 0;
+    }
+
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "game") {
+        test::bench::game();
+        return 0;
+    }
+
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "scale") {
+        test::bench::scale();
+        return 0;
+    }
+
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "arch") {
+        test::bench::arch();
+        return 0;
+    }
+
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "refresh") {
+        test::bench::refresh();
+        return 0;
+    }
+
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "leaves") {
+        test::bench::leaves();
+        return 0;
+    }
+
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "int8") {
+        test::bench::int8(argc > 3 ? argv[3] : "");
+        return 0;
+    }
+
+    // Writes the int8 quantization of a net file
+    if (argc > 3 && std::string(argv[1]) == "quantize") {
+        const auto error = nnue::load(argv[2]);
+
+        if (error != nnue::Error::NONE) {
+            std::cout << "failed to load " << argv[2] << ": " << nnue::get_error_name(error) << std::endl;
+            return 1;
+        }
+
+        const auto clamped = nnue::quantize();
+
+        if (!nnue::save(argv[3])) {
+            std::cout << "failed to write " << argv[3] << std::endl;
+            return 1;
+        }
+
+        std::cout << "wrote " << nnue::get_name() << " to " << argv[3] << ", " << clamped << " weights were saturated" << std::endl;
+        return 0;
+    }
+
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "evalbatch") {
+        test::bench::evalbatch(argc > 3 ? argv[3] : "");
+        return 0;
+    }
+
+    // Converts packed datagen records or games to the text format
+    if (argc > 3 && std::string(argv[1]) == "convert") {
+        const bool games = argc > 4 && std::string(argv[4]) == "games";
+        const auto count = datagen::format::convert(argv[2], argv[3], games, datagen::Config().visit);
+
+        if (!count.has_value()) {
+            std::cout << "failed to read " << argv[2] << " or to write " << argv[3] << std::endl;
+            return 1;
+        }
+
+        std::cout << "converted " << count.value() << " positions" << std::endl;
+        return 0;
+    }
+
+    // Merges datagen shards into one file, shuffle also shuffles their records
+    if (argc > 3 && (std::string(argv[1]) == "merge" || std::string(argv[1]) == "shuffle")) {
+        const auto size = datagen::format::merge({ argv + 3, argv + argc }, argv[2], std::string(argv[1]) == "shuffle", timer::get_current());
+
+        if (!size.has_value()) {
+            std::cout << "failed to read the shards or to write " << argv[2] << std::endl;
+            return 1;
+        }
+
+        std::cout << "merged " << size.value() << " bytes" << std::endl;
+        return 0;
+    }
+
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "format") {
+        test::bench::format();
+        return 0;
+    }
+
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "datagen") {
+        const auto config = datagen::config::parse({ argv + 3, argv + argc });
+
+        if (!config.has_value()) {
+            std::cout << "failed to read the datagen settings" << std::endl;
+            return 1;
+        }
+
+        test::bench::datagen(config.value());
+        return 0;
+    }
+
+    // Rescores a file of fens with the embedded net
+    if (argc > 3 && std::string(argv[1]) == "evalbatch") {
+        const u64 thread_count = argc > 4 ? std::stoull(argv[4]) : std::max(std::thread::hardware_concurrency(), 1U);
+
+        const auto invalid = datagen::batch::run(argv[2], argv[3], thread_count);
+
+        if (!invalid.has_value()) {
+            std::cout << "failed to read " << argv[2] << " or to write " << argv[3] << std::endl;
+            return 1;
+        }
+
+        if (invalid.value() > 0) {
+            std::cout << "skipped " << invalid.value() << " lines with an invalid fen" << std::endl;
+        }
+
+        return 0;
+    }
+
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "evalcache") {
+        test::bench::evalcache();
+        return 0;
+    }
 
+    if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "multipv") {
+        test::bench::multipv();
         return 0;
     }
 
     if (argc > 1 && std::string(argv[1]) == "bench") {
-        test::bench::test();
+        u64 thread_count = 1;
+
+        if (argc > 2) {
+            thread_count = std::stoull(argv[2]);
+        }
+
+        test::bench::test(thread_count);
         return 0;
     }
 
@@ -35,6 +175,16 @@ int main(int argc, char* argv[])
 
     engine.set({ .hash = 16, .threads = 1 });
 
+    // The table is rebuilt in the background after a setoption, its timings are printed once it's ready
+    bool is_hash_pending = false;
+
+    auto print_hash = [&] () {
+        if (is_hash_pending) {
+            uci::print::hash(setoption.hash, engine.table.page, engine.table.time_init, engine.table.time_clear);
+            is_hash_pending = false;
+        }
+    };
+
     while (true)
     {
         // Gets input
@@ -64,11 +214,21 @@ int main(int argc, char* argv[])
 
             std::cout << "uciok" << std::endl;
 
+            uci::print::info_string("using " + cpu::get_name() + " kernels");
+
+            continue;
+        }
+
+        if (tokens[0] == "setoption" && tokens.size() >= 4 && tokens[2] == "Clear" && tokens[3] == "Hash") {
+            engine.clear_table();
+
+            uci::print::info_string("hash cleared in " + std::to_string(engine.table.time_clear) + " ms");
+
             continue;
         }
 
         if (tokens[0] == "setoption") {
-            auto uci_setoption = uci::parse::setoption(input);
+            auto uci_setoption = uci::parse::setoption(input, setoption);
 
             if (!uci_setoption.has_value()) {
                 std::cout << "Invalid option!" << std::endl;
@@ -77,12 +237,18 @@ int main(int argc, char* argv[])
 
             setoption = uci_setoption.value();
 
-            engine.set(setoption);
+            is_hash_pending |= engine.set(setoption);
 
             continue;
         }
 
         if (tokens[0] == "isready") {
+            // Waits for background work, but never for a search
+            if (!engine.running.test()) {
+                engine.join();
+                print_hash();
+            }
+
             std::cout << "readyok" << std::endl;
 
             continue;
@@ -92,8 +258,12 @@ int main(int argc, char* argv[])
             board = Board();
             go = uci::parse::Go();
 
-            engine.stop();
-            engine.clear();
+            // Old hash entries are invalidated lazily instead of clearing the whole table
+            const u64 time_start = timer::get_current_us();
+
+            engine.clear(true);
+
+            uci::print::info_string("hash invalidated and history cleared in " + std::to_string(timer::get_current_us() - time_start) + " us");
 
             continue;
         }
@@ -124,7 +294,7 @@ int main(int argc, char* argv[])
 
         if (tokens[0] == "go") {
             // Reads go infos
-            auto uci_go = uci::parse::go(input);
+            auto uci_go = uci::parse::go(input, board);
 
             if (!uci_go.has_value()) {
                 std::cout << "Invalid go command!" << std::endl;
@@ -135,6 +305,7 @@ int main(int argc, char* argv[])
 
             // Stops thread
             engine.stop();
+            print_hash();
 
             // Starts search thread
             engine.search<false>(board, go);
@@ -142,6 +313,12 @@ int main(int argc, char* argv[])
             continue;
         }
 
+        if (tokens[0] == "ponderhit") {
+            engine.ponderhit();
+
+            continue;
+        }
+
         if (tokens[0] == "stop") {
             // Stops thread
             engine.stop();
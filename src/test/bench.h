@@ -1,6 +1,9 @@
 #pragma once
 
+#include <filesystem>
+
 #include "../engine/search.h"
+#include "../datagen/datagen.h"
 
 namespace test::bench
 {
@@ -32,14 +35,28 @@ inline std::vector<std::string> set = {
     "1r4k1/Q4ppp/8/8/4P3/8/K4PPP/1r3BR1 w - - 1 36"
 };
 
-inline void test()
+// Morphy vs Duke Karl / Count Isouard, Paris 1858
+inline std::vector<std::string> game_moves = {
+    "e2e4", "e7e5", "g1f3", "d7d6", "d2d4", "c8g4", "d4e5", "g4f3",
+    "d1f3", "d6e5", "f1c4", "g8f6", "f3b3", "d8e7", "b1c3", "c7c6",
+    "c1g5", "b7b5", "c3b5", "c6b5", "c4b5", "b8d7", "e1c1", "a8d8",
+    "d1d7", "d8d7", "h1d1", "e7e6", "b5d7", "f6d7", "b3b8", "d7b8"
+};
+
+inline void test(u64 threads = 1)
 {
     auto engine = search::Engine();
-    engine.set({ .hash = 16 });
+    engine.set({ .hash = 16, .threads = threads });
     engine.clear();
 
     u64 nodes = 0;
     u64 time = 0;
+    u64 latency = 0;
+    u64 nnue_update = 0;
+    u64 nnue_skip = 0;
+    u64 nnue_fused = 0;
+    u64 eval_probe = 0;
+    u64 eval_hit = 0;
 
     for (const auto& test : set) {
         auto board = Board(test);
@@ -56,11 +73,704 @@ inline void test()
 
         nodes += engine.nodes;
         time += engine.time;
+        latency += engine.latency;
+        nnue_update += engine.nnue_update;
+        nnue_skip += engine.nnue_skip;
+        nnue_fused += engine.nnue_fused;
+        eval_probe += engine.eval_probe;
+        eval_hit += engine.eval_hit;
 
         engine.clear();
     }
 
+    std::cout << "search start latency " << (latency / set.size()) << " us" << std::endl;
+    std::cout <<
+        "nnue updates " << nnue_update <<
+        " skipped " << nnue_skip << " (" << (nnue_skip * 100 / std::max(nnue_update, u64(1))) << "%)" <<
+        " fused " << nnue_fused << " (" << (nnue_fused * 100 / std::max(nnue_update, u64(1))) << "%)" << std::endl;
+    std::cout << "eval cache probes " << eval_probe << " hits " << eval_hit << " (" << (eval_hit * 100 / std::max(eval_probe, u64(1))) << "%)" << std::endl;
     std::cout << nodes << " nodes " << (nodes * 1000 / time) << " nps" << std::endl;
 };
 
+// Searches every position of a game in order, like a game played under uci
+// Compares clearing history tables between moves against keeping them
+inline u64 game(bool keep_history)
+{
+    auto engine = search::Engine();
+    engine.set({ .hash = 16 });
+    engine.clear();
+
+    auto board = Board();
+    u64 nodes = 0;
+
+    for (const auto& token : game_moves) {
+        auto go = uci::parse::Go {
+            .depth = 12,
+            .time = { UINT32_MAX, UINT32_MAX },
+            .increment = { 0, 0 },
+            .movestogo = {},
+            .infinite = true,
+        };
+
+        if (!keep_history) {
+            engine.clear_history();
+        }
+
+        engine.search<true>(board, go);
+        engine.join();
+
+        nodes += engine.nodes;
+
+        board.make(uci::parse::move(token, board).value());
+    }
+
+    return nodes;
+};
+
+struct Result
+{
+    u64 nodes = 0;
+    u64 time = 0;
+    u64 eval_probe = 0;
+    u64 eval_hit = 0;
+};
+
+// Searches the bench positions at fixed depth, the time is wall time
+inline Result run(uci::parse::Setoption option, i32 depth)
+{
+    auto engine = search::Engine();
+    engine.set(option);
+
+    u64 nodes = 0;
+    u64 time = 0;
+    u64 eval_probe = 0;
+    u64 eval_hit = 0;
+
+    for (const auto& test : set) {
+        auto board = Board(test);
+        auto go = uci::parse::Go {
+            .depth = depth,
+            .time = { UINT32_MAX, UINT32_MAX },
+            .increment = { 0, 0 },
+            .movestogo = {},
+            .infinite = true,
+        };
+
+        engine.clear();
+
+        const u64 start = timer::get_current();
+
+        engine.search<true>(board, go);
+        engine.join();
+
+        time += timer::get_current() - start;
+        nodes += engine.nodes;
+        eval_probe += engine.eval_probe;
+        eval_hit += engine.eval_hit;
+    }
+
+    return Result { .nodes = nodes, .time = std::max(time, u64(1)), .eval_probe = eval_probe, .eval_hit = eval_hit };
+};
+
+// Measures nps at fixed depth with the given thread setup
+inline u64 get_nps(u64 threads, bool numa)
+{
+    const auto result = run({ .hash = 64, .threads = threads, .numa = numa }, 12);
+
+    return result.nodes * 1000 / result.time;
+};
+
+// Compares the nps and time to depth of multipv searches against a single pv search
+inline void multipv()
+{
+    const auto base = run({ .hash = 64, .multipv = 1 }, 12);
+
+    for (const u64 count : { 1, 4, 8 }) {
+        const auto result = count == 1 ? base : run({ .hash = 64, .multipv = count }, 12);
+
+        std::cout <<
+            "multipv " << count <<
+            " | nodes " << result.nodes <<
+            " | time " << result.time << " ms" <<
+            " | nps " << (result.nodes * 1000 / result.time) <<
+            " | time to depth " << f64(result.time) / f64(base.time) << "x" << std::endl;
+    }
+};
+
+// Runs the bench positions with every supported kernel set, the node counts must match
+inline void arch()
+{
+    for (const auto target : cpu::ARCHS) {
+        if (!cpu::is_supported(target)) {
+            continue;
+        }
+
+        for (const bool pext : { false, true }) {
+            if (pext && !cpu::is_pext_fast()) {
+                continue;
+            }
+
+            // Slider tables are indexed differently with pext
+            cpu::set(target, pext);
+            attack::init();
+
+            const auto result = run({ .hash = 16 }, 12);
+
+            std::cout <<
+                "kernels " << cpu::get_name() <<
+                " | nodes " << result.nodes <<
+                " | time " << result.time << " ms" <<
+                " | nps " << (result.nodes * 1000 / result.time) << std::endl;
+        }
+    }
+
+    cpu::init();
+    attack::init();
+};
+
+// Reports nps scaling from 1 thread to all cores, with and without numa mode
+inline void scale()
+{
+    const u64 cores = std::max(u64(std::thread::hardware_concurrency()), u64(1));
+    const bool has_numa = numa::nodes.size() > 1;
+
+    std::vector<u64> counts = {};
+
+    for (u64 i = 1; i < cores; i *= 2) {
+        counts.push_back(i);
+    }
+
+    counts.push_back(cores);
+
+    std::cout << "numa nodes: " << numa::get_count() << std::endl;
+
+    u64 base = 0;
+    u64 base_numa = 0;
+
+    for (const u64 threads : counts) {
+        const u64 nps = get_nps(threads, false);
+
+        base = base == 0 ? nps : base;
+
+        std::cout << "threads " << threads << " | nps " << nps << " | speedup " << f64(nps) / f64(base);
+
+        if (has_numa) {
+            const u64 nps_numa = get_nps(threads, true);
+
+            base_numa = base_numa == 0 ? nps_numa : base_numa;
+
+            std::cout << " | numa nps " << nps_numa << " | numa speedup " << f64(nps_numa) / f64(base_numa);
+        }
+
+        std::cout << std::endl;
+    }
+};
+
+inline void game()
+{
+    const u64 nodes_cleared = game(false);
+    const u64 nodes_kept = game(true);
+
+    std::cout << "history cleared: " << nodes_cleared << " nodes" << std::endl;
+    std::cout << "history kept: " << nodes_kept << " nodes" << std::endl;
+    std::cout << "saved: " << (f64(nodes_cleared) - f64(nodes_kept)) / f64(nodes_cleared) * 100.0 << "%" << std::endl;
+};
+
+// Measures the cost of a full accumulator rebuild against a refresh through the cache
+// Game positions follow each other like refreshes in a search, the bench set has unrelated positions
+inline u64 get_refresh_time(std::vector<Board>& boards, bool cached)
+{
+    constexpr u64 ROUNDS = 20000;
+
+    auto nnue = nnue::Net();
+
+    u64 checksum = 0;
+
+    const u64 start = timer::get_current_us();
+
+    for (u64 r = 0; r < ROUNDS; ++r) {
+        for (auto& board : boards) {
+            nnue.refresh(board, cached);
+
+            const auto accumulator = nnue.get_accumulator(color::WHITE);
+
+            checksum += accumulator[r % accumulator.size()];
+        }
+    }
+
+    const u64 time = timer::get_current_us() - start;
+
+    // Keeps the refreshes from being optimized away
+    if (checksum == 1) {
+        std::cout << std::endl;
+    }
+
+    return std::max(time * 1000 / (ROUNDS * boards.size()), u64(1));
+};
+
+inline void refresh()
+{
+    std::vector<Board> game_boards = {};
+    std::vector<Board> set_boards = {};
+
+    auto board = Board();
+
+    for (const auto& token : game_moves) {
+        board.make(uci::parse::move(token, board).value());
+        game_boards.push_back(board);
+    }
+
+    for (const auto& fen : set) {
+        set_boards.push_back(Board(fen));
+    }
+
+    for (auto [name, boards] : { std::pair { "game", game_boards }, std::pair { "bench set", set_boards } }) {
+        const u64 full = get_refresh_time(boards, false);
+        const u64 cached = get_refresh_time(boards, true);
+
+        std::cout <<
+            name <<
+            " | full refresh " << full << " ns" <<
+            " | cached refresh " << cached << " ns" <<
+            " | speedup " << f64(full) / f64(cached) << "x" << std::endl;
+    }
+};
+
+// Evaluates every child of the bench positions and their children after a move, like the leaves of a qsearch
+// Only the leaf evaluations are timed, the checksum keeps them from being optimized away
+template <bool FUSED>
+inline Result get_leaves(std::vector<Board>& boards, i64& checksum)
+{
+    constexpr u64 ROUNDS = 10;
+
+    auto nnue = nnue::Net();
+
+    u64 evals = 0;
+    u64 time = 0;
+
+    for (u64 r = 0; r < ROUNDS; ++r) {
+        for (auto& board : boards) {
+            nnue.refresh(board);
+
+            for (const u16& move : move::gen::get<move::gen::type::ALL>(board)) {
+                if (!board.is_legal(move)) {
+                    continue;
+                }
+
+                nnue.make(board, move);
+                board.make(move);
+
+                const u64 start = timer::get_current_ns();
+
+                checksum += nnue.get_eval<FUSED>(board);
+
+                time += timer::get_current_ns() - start;
+                evals += 1;
+
+                nnue.unmake();
+                board.unmake(move);
+            }
+        }
+    }
+
+    return Result { .nodes = evals, .time = std::max(time, u64(1)) };
+};
+
+// Bench positions and every position reachable from them within the given number of plies
+inline void get_positions(Board& board, i32 ply, std::vector<Board>& boards)
+{
+    boards.push_back(board);
+
+    if (ply == 0) {
+        return;
+    }
+
+    for (const u16& move : move::gen::get<move::gen::type::ALL>(board)) {
+        if (!board.is_legal(move)) {
+            continue;
+        }
+
+        board.make(move);
+        bench::get_positions(board, ply - 1, boards);
+        board.unmake(move);
+    }
+};
+
+inline std::vector<Board> get_positions(i32 ply)
+{
+    std::vector<Board> boards = {};
+
+    for (const auto& fen : set) {
+        auto board = Board(fen);
+
+        bench::get_positions(board, ply, boards);
+    }
+
+    return boards;
+};
+
+inline void leaves()
+{
+    auto boards = bench::get_positions(2);
+
+    i64 checksum_unfused = 0;
+    i64 checksum_fused = 0;
+
+    const auto unfused = get_leaves<false>(boards, checksum_unfused);
+    const auto fused = get_leaves<true>(boards, checksum_fused);
+
+    for (auto [name, result] : { std::pair { "unfused", unfused }, std::pair { "fused", fused } }) {
+        std::cout <<
+            name <<
+            " | positions " << boards.size() <<
+            " | leaves " << result.nodes <<
+            " | time " << result.time / 1000000 << " ms" <<
+            " | leaf evals per second " << (result.nodes * 1000000000 / result.time) << std::endl;
+    }
+
+    if (checksum_unfused != checksum_fused) {
+        std::cout << "ERROR: fused and unfused evals differ" << std::endl;
+    }
+};
+
+// Compares the int16 input weights of a net with their int8 quantization
+// The eval difference is measured on the bench positions and their children
+inline void int8(const std::string& path = "")
+{
+    auto boards = bench::get_positions(1);
+
+    auto get_evals = [&] () {
+        std::vector<i32> evals = {};
+
+        for (auto& board : boards) {
+            auto nnue = nnue::Net();
+
+            nnue.refresh(board);
+            evals.push_back(nnue.get_eval(board));
+        }
+
+        return evals;
+    };
+
+    nnue::init();
+
+    for (const bool quantized : { false, true }) {
+        const auto result = run({ .hash = 16, .evalfile = path, .int8 = quantized }, 12);
+
+        std::cout <<
+            "net " << nnue::get_name() <<
+            " | nodes " << result.nodes <<
+            " | time " << result.time << " ms" <<
+            " | nps " << (result.nodes * 1000 / result.time) << std::endl;
+    }
+
+    // The int8 net is still loaded after the last run
+    const auto evals_int8 = get_evals();
+
+    if (path.empty()) {
+        nnue::init();
+    }
+    else {
+        nnue::load(path);
+    }
+
+    const auto evals = get_evals();
+    const auto clamped = nnue::quantize();
+
+    i32 diff_max = 0;
+    i64 diff_sum = 0;
+
+    for (usize i = 0; i < evals.size(); ++i) {
+        diff_max = std::max(diff_max, std::abs(evals[i] - evals_int8[i]));
+        diff_sum += std::abs(evals[i] - evals_int8[i]);
+    }
+
+    std::cout <<
+        "positions " << evals.size() <<
+        " | saturated weights " << clamped <<
+        " | max eval diff " << diff_max <<
+        " | mean eval diff " << double(diff_sum) / double(evals.size()) << std::endl;
+
+    nnue::init();
+};
+
+
+// Compares the batch eval with evaluating one position at a time through a network
+// The positions are shuffled like the ones of a rescoring job, so that neighbours rarely share an accumulator
+inline void evalbatch(const std::string& path = "")
+{
+    constexpr u64 ROUNDS = 20;
+
+    if (!path.empty() && nnue::load(path) != nnue::Error::NONE) {
+        std::cout << "failed to load " << path << std::endl;
+        return;
+    }
+
+    auto boards = bench::get_positions(2);
+
+    u64 seed = 0x9E3779B97F4A7C15ULL;
+
+    for (usize i = boards.size() - 1; i > 0; --i) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+
+        std::swap(boards[i], boards[seed % (i + 1)]);
+    }
+
+    auto positions = std::vector<nnue::Position>();
+    auto evals = std::vector<i32>(boards.size());
+    auto batch = std::vector<i32>(boards.size());
+
+    for (auto& board : boards) {
+        positions.push_back(nnue::get_position(board));
+    }
+
+    for (const bool cached : { false, true }) {
+        auto nnue = nnue::Net();
+
+        const u64 start = timer::get_current_us();
+
+        for (u64 r = 0; r < ROUNDS; ++r) {
+            for (usize i = 0; i < boards.size(); ++i) {
+                nnue.refresh(boards[i], cached);
+                evals[i] = nnue.get_eval(boards[i]);
+            }
+        }
+
+        const u64 time = std::max(timer::get_current_us() - start, u64(1));
+
+        std::cout <<
+            (cached ? "single cached" : "single") <<
+            " | positions " << boards.size() <<
+            " | time " << time / 1000 << " ms" <<
+            " | positions/s " << (ROUNDS * boards.size() * 1000000 / time) << std::endl;
+    }
+
+    for (const u64 threads : { u64(1), u64(std::max(std::thread::hardware_concurrency(), 1U)) }) {
+        const u64 start = timer::get_current_us();
+
+        for (u64 r = 0; r < ROUNDS; ++r) {
+            nnue::evaluate(positions, batch, threads);
+        }
+
+        const u64 time = std::max(timer::get_current_us() - start, u64(1));
+
+        std::cout <<
+            "batch " << threads << " threads" <<
+            " | positions " << boards.size() <<
+            " | time " << time / 1000 << " ms" <<
+            " | positions/s " << (ROUNDS * boards.size() * 1000000 / time) <<
+            " | " << (batch == evals ? "exact" : "mismatch") << std::endl;
+    }
+
+    nnue::init();
+};
+
+
+// Compares eval cache sizes with a small and a regular hash, the searches are the same so only the speed changes
+// Without the cache, evals of positions that the table lost or never stored are always recomputed
+inline void evalcache()
+{
+    for (const u64 hash : { u64(1), u64(16) }) {
+        for (const u64 size : { u64(0), u64(64), u64(256), u64(1024), u64(4096) }) {
+            const auto result = run({ .hash = hash, .eval_cache = size }, 12);
+
+            std::cout <<
+                "hash " << hash << " MB" <<
+                " | eval cache " << size << " KB" <<
+                " | nodes " << result.nodes <<
+                " | time " << result.time << " ms" <<
+                " | nps " << (result.nodes * 1000 / result.time) <<
+                " | hits " << (result.eval_hit * 100 / std::max(result.eval_probe, u64(1))) << "%" << std::endl;
+        }
+    }
+};
+
+
+// Compares writing datagen positions as text lines, like datagen used to, with writing them as packed records
+inline void format()
+{
+    constexpr u64 ROUNDS = 20;
+
+    const auto path = (std::filesystem::temp_directory_path() / "iris_bench_format").string();
+    const auto path_text = path + ".txt";
+
+    auto boards = bench::get_positions(2);
+
+    for (const bool packed : { false, true }) {
+        std::filesystem::remove(path);
+
+        const u64 start = timer::get_current_us();
+
+        if (packed) {
+            auto writer = datagen::format::Writer(path);
+
+            for (u64 r = 0; r < ROUNDS; ++r) {
+                for (usize i = 0; i < boards.size(); ++i) {
+                    writer.write(datagen::format::pack(boards[i], i32(i % 2000) - 1000, datagen::format::result::DRAW));
+                }
+            }
+        }
+        else {
+            for (u64 r = 0; r < ROUNDS; ++r) {
+                std::vector<std::string> lines;
+
+                for (usize i = 0; i < boards.size(); ++i) {
+                    lines.push_back(boards[i].get_fen() + " | " + std::to_string(i32(i % 2000) - 1000) + " | 0.5");
+                }
+
+                std::ofstream o(path, std::ios::out | std::ios::app);
+
+                for (auto& line : lines) {
+                    o << line << std::endl;
+                }
+            }
+        }
+
+        const u64 time = std::max(timer::get_current_us() - start, u64(1));
+        const u64 count = ROUNDS * boards.size();
+
+        std::cout <<
+            (packed ? "packed" : "text") <<
+            " | positions " << count <<
+            " | time " << time / 1000 << " ms" <<
+            " | positions/s " << (count * 1000000 / time) <<
+            " | bytes/position " << (f64(std::filesystem::file_size(path)) / f64(count)) << std::endl;
+    }
+
+    const u64 start = timer::get_current_us();
+    const auto count = datagen::format::convert(path, path_text).value_or(0);
+    const u64 time = std::max(timer::get_current_us() - start, u64(1));
+
+    std::cout <<
+        "convert" <<
+        " | positions " << count <<
+        " | time " << time / 1000 << " ms" <<
+        " | positions/s " << (count * 1000000 / time) << std::endl;
+
+    // Game records, random games from the start position since only the move count matters for the size
+    std::filesystem::remove(path);
+
+    std::vector<datagen::format::Game> games;
+    u64 seed = 1070372;
+    u64 move_count = 0;
+
+    for (usize i = 0; i < 2000; ++i) {
+        auto board = Board();
+        auto game = datagen::format::Game();
+
+        game.start = datagen::format::pack(board, 0);
+
+        while (game.moves.size() < 200 && !board.is_draw())
+        {
+            const auto moves = move::gen::get_legal(board);
+
+            if (moves.size() == 0) {
+                break;
+            }
+
+            seed ^= seed >> 12;
+            seed ^= seed << 25;
+            seed ^= seed >> 27;
+
+            const u16 move = moves[(seed * 2685821657736338717ULL) % moves.size()];
+
+            game.moves.push_back({ .move = move, .score = i16(i % 2000) });
+            board.make(move);
+        }
+
+        move_count += game.moves.size();
+        games.push_back(std::move(game));
+    }
+
+    const u64 game_start = timer::get_current_us();
+
+    {
+        auto writer = datagen::format::Writer(path);
+
+        for (const auto& game : games) {
+            writer.write(game);
+        }
+    }
+
+    const u64 game_time = std::max(timer::get_current_us() - game_start, u64(1));
+
+    // Decodes them back to the kept positions
+    const u64 decode_start = timer::get_current_us();
+
+    auto reader = datagen::format::Reader(path);
+    auto game = datagen::format::Game();
+    auto board = Board();
+    std::vector<datagen::format::Record> records;
+
+    while (reader.read(game))
+    {
+        datagen::format::get_records(game, board, records);
+    }
+
+    const u64 decode_time = std::max(timer::get_current_us() - decode_start, u64(1));
+    const f64 size = f64(std::filesystem::file_size(path));
+
+    std::cout <<
+        "games" <<
+        " | positions " << move_count <<
+        " | time " << game_time / 1000 << " ms" <<
+        " | positions/s " << (move_count * 1000000 / game_time) <<
+        " | bytes/position " << (size / f64(move_count)) <<
+        " | bytes/kept " << (size / f64(std::max(records.size(), usize(1)))) << std::endl;
+
+    std::cout <<
+        "decode" <<
+        " | positions " << records.size() <<
+        " | time " << decode_time / 1000 << " ms" <<
+        " | positions/s " << (records.size() * 1000000 / decode_time) << std::endl;
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(path_text);
+};
+
+// Plays datagen games on one thread from seeded openings, the config sets the search and the adjudication
+inline void datagen(const datagen::Config& config)
+{
+    constexpr u64 GAMES = 16;
+
+    auto rng = datagen::Rng(0);
+    rng.seed = 1070372;
+
+    u64 games = 0;
+    u64 moves = 0;
+    u64 positions = 0;
+
+    auto players = std::array<datagen::game::Player, 2>();
+
+    const u64 start = timer::get_current();
+
+    while (games < GAMES)
+    {
+        auto board = datagen::get_random_opening(rng, {}, config.random);
+
+        if (std::abs(datagen::get_opening_score(board, players[0], config)) >= config.opening_delta) {
+            continue;
+        }
+
+        const auto result = datagen::game::run(board, players, config);
+
+        games += 1;
+        moves += result.game.moves.size();
+        positions += std::min(result.kept, config.visit);
+    }
+
+    const u64 time = std::max(timer::get_current() - start, u64(1));
+
+    std::cout <<
+        "games " << games <<
+        " | moves " << moves <<
+        " | positions " << positions <<
+        " | time " << time << " ms" <<
+        " | games/s " << (f64(games) * 1000.0 / f64(time)) <<
+        " | moves/s " << (moves * 1000 / time) <<
+        " | positions/s " << (positions * 1000 / time) << std::endl;
+};
+
 };
\ No newline at end of file
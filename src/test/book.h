@@ -0,0 +1,103 @@
+#pragma once
+
+#include "../datagen/book.h"
+
+namespace test::book
+{
+
+struct San
+{
+    std::string fen;
+    std::string san;
+    std::string expected;
+};
+
+// An empty expected move means the san must be rejected
+inline std::vector<San> san_set = {
+    { "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", "Nf3", "g1f3" },
+    { "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", "e4", "e2e4" },
+    { "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", "e5", "" },
+    { "4k3/8/8/8/8/8/R6R/4K3 w - - 0 1", "Rd2", "" },
+    { "4k3/8/8/8/8/8/R6R/4K3 w - - 0 1", "Rad2", "a2d2" },
+    { "4k3/8/8/8/8/8/R6R/4K3 w - - 0 1", "Rhd2+", "h2d2" },
+    { "4k3/8/8/8/8/8/8/R3K2R w KQ - 0 1", "O-O", "e1g1" },
+    { "4k3/8/8/8/8/8/8/R3K2R w KQ - 0 1", "O-O-O", "e1c1" },
+    { "4k3/8/8/8/R7/8/8/R3K3 w Q - 0 1", "Ra2", "" },
+    { "4k3/8/8/8/R7/8/8/R3K3 w Q - 0 1", "R1a2", "a1a2" },
+    { "4k3/8/8/8/R7/8/8/R3K3 w Q - 0 1", "R4a2!?", "a4a2" },
+    { "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3", "exf6", "e5f6" },
+    { "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3", "exd6", "" },
+    { "4k3/P7/8/8/8/8/8/4K3 w - - 0 1", "a8=N", "a7a8n" },
+    { "4k3/P7/8/8/8/8/8/4K3 w - - 0 1", "a8Q+", "a7a8q" },
+    { "4k3/P7/8/8/8/8/8/4K3 w - - 0 1", "a8", "" }
+};
+
+inline std::string pgn =
+    "[Event \"a\"]\n"
+    "[Site \"?\"]\n"
+    "\n"
+    "1. e4 e5 2. Nf3 {a comment} Nc6 3. Bb5 a6 (3... Nf6 4. O-O) 4. Ba4 Nf6 5. O-O $1 Be7 1-0\n"
+    "\n"
+    "[Event \"b\"]\n"
+    "[FEN \"4k3/P7/8/8/8/8/8/4K3 w - - 0 1\"]\n"
+    "[SetUp \"1\"]\n"
+    "\n"
+    "1. a8=Q+ Kd7 *\n"
+    "\n"
+    "[Event \"c\"]\n"
+    "\n"
+    "1. e4 Zz9 2. d4 1/2-1/2\n"
+    "\n"
+    "1.d4 d5 2.c4 dxc4 3.e3 b5 4.a4 c6 5.axb5 cxb5 6.Qf3 ; a line comment\n"
+    "0-1\n";
+
+inline std::vector<std::string> pgn_expected = {
+    "r1bqk2r/1pppbppp/p1n2n2/4p3/B3P3/5N2/PPPP1PPP/RNBQ1RK1 w kq - 4 6",
+    "Q7/3k4/8/8/8/8/8/4K3 w - - 1 2",
+    "rnbqkbnr/p3pppp/8/1p6/2pP4/4PQ2/1P3PPP/RNB1KBNR b KQkq - 1 6"
+};
+
+inline std::string epd =
+    "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - bm e5; id \"a\";\n"
+    "\n"
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 3 9\n";
+
+inline std::vector<std::string> epd_expected = {
+    "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 3 9"
+};
+
+inline void test()
+{
+    std::cout << "BOOK TEST" << std::endl;
+
+    bool result = true;
+
+    for (const auto& entry : san_set) {
+        auto board = Board(entry.fen);
+        const auto move = datagen::book::get_move(board, entry.san);
+        const auto str = move.has_value() ? move::get_str(move.value()) : "";
+
+        if (str != entry.expected) {
+            std::cout << "san " << entry.san << " in " << entry.fen << " gave " << str << ", expected " << entry.expected << std::endl;
+            result = false;
+        }
+    }
+
+    auto pgn_in = std::stringstream(pgn);
+    auto epd_in = std::stringstream(epd);
+
+    result &= datagen::book::parse_pgn(pgn_in) == pgn_expected;
+    result &= datagen::book::parse_epd(epd_in) == epd_expected;
+
+    std::cout << std::endl;
+
+    if (result) {
+        std::cout << "passed!" << std::endl;
+    }
+    else {
+        std::cout << "failed!" << std::endl;
+    }
+};
+
+};
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <filesystem>
+
 #include "../engine/search.h"
+#include "../datagen/batch.h"
 
 namespace test::nn
 {
@@ -21,10 +24,13 @@ inline bool check(Board& board, nnue::Net& nnue, i32 depth)
         nnue.make(board, move);
         board.make(move);
 
-        auto raw = nnue::Net();
-        raw.refresh(board);
+        // Reused between positions, only the cache free refresh is compared against
+        static auto raw = nnue::Net();
+
+        raw.clear();
+        raw.refresh(board, false);
 
-        if (nnue.get_eval(board.get_color()) != raw.get_eval(board.get_color())) {
+        if (nnue.get_eval(board) != raw.get_eval(board)) {
             nnue.unmake();
             board.unmake(move);
 
@@ -48,6 +54,110 @@ inline bool check(Board& board, nnue::Net& nnue, i32 depth)
     return true;
 };
 
+// Refreshes through the same cache in a walk over the tree, so entries are reused across unrelated positions
+inline bool check_cache(Board& board, nnue::Net& cached, i32 depth)
+{
+    auto raw = nnue::Net();
+
+    raw.refresh(board, false);
+    cached.refresh(board);
+
+    const bool is_equal =
+        std::ranges::equal(raw.get_accumulator(color::WHITE), cached.get_accumulator(color::WHITE)) &&
+        std::ranges::equal(raw.get_accumulator(color::BLACK), cached.get_accumulator(color::BLACK));
+
+    if (!is_equal) {
+        std::cout << "ERROR: \n";
+        board.print();
+
+        return false;
+    }
+
+    if (depth <= 0) {
+        return true;
+    }
+
+    auto moves = move::gen::get<move::gen::type::ALL>(board);
+
+    for (const u16& move : moves) {
+        if (!board.is_legal(move)) {
+            continue;
+        }
+
+        board.make(move);
+
+        bool c = check_cache(board, cached, depth - 1);
+
+        board.unmake(move);
+
+        if (!c) {
+            return false;
+        }
+    }
+
+    return true;
+};
+
+// Evaluates every position of the tree with each supported kernel set, the results must match the scalar kernels exactly
+inline bool check_arch(Board& board, i32 depth)
+{
+    const auto arch = cpu::arch;
+
+    cpu::set(cpu::Arch::SCALAR, cpu::pext);
+
+    auto scalar = nnue::Net();
+    scalar.refresh(board, false);
+
+    const i32 expected = scalar.get_eval(board);
+
+    bool result = true;
+
+    for (const auto candidate : cpu::ARCHS) {
+        if (!cpu::is_supported(candidate)) {
+            continue;
+        }
+
+        cpu::set(candidate, cpu::pext);
+
+        auto nnue = nnue::Net();
+        nnue.refresh(board, false);
+
+        if (nnue.get_eval(board) != expected) {
+            std::cout << "ERROR: " << cpu::get_name(candidate) << "\n";
+            board.print();
+
+            result = false;
+            break;
+        }
+    }
+
+    cpu::set(arch, cpu::pext);
+
+    if (!result || depth <= 0) {
+        return result;
+    }
+
+    auto moves = move::gen::get<move::gen::type::ALL>(board);
+
+    for (const u16& move : moves) {
+        if (!board.is_legal(move)) {
+            continue;
+        }
+
+        board.make(move);
+
+        bool c = check_arch(board, depth - 1);
+
+        board.unmake(move);
+
+        if (!c) {
+            return false;
+        }
+    }
+
+    return true;
+};
+
 struct Test
 {
     std::string name;
@@ -64,6 +174,258 @@ inline std::vector<Test> set = {
     Test { .name = "busy", .fen = "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", .depth = 4 }
 };
 
+// Net of the given shape with random weights and input buckets, the weights are small so that nothing overflows
+inline std::vector<u8> get_random(usize shape, u64 seed)
+{
+    return nnue::with_layout(shape, [&] <typename L> (L) {
+        auto header = nnue::Header {};
+
+        std::memcpy(header.magic, nnue::MAGIC, sizeof(header.magic));
+        header.version = nnue::VERSION;
+        header.hidden = L::HIDDEN;
+        header.input_bucket = L::INPUT_BUCKET;
+        header.output_bucket = L::OUTPUT_BUCKET;
+        header.mirror = L::MIRROR;
+        header.weight = 8 * sizeof(typename L::Weight);
+
+        // Neighbouring squares get different buckets, so that most king moves change bucket
+        for (usize square = 0; square < 64; ++square) {
+            header.buckets[square] = (square / 8 + square % 8) % L::INPUT_BUCKET;
+        }
+
+        auto data = std::vector<u8>(sizeof(nnue::Header) + nnue::get_size<L>());
+
+        std::memcpy(data.data(), &header, sizeof(nnue::Header));
+
+        for (usize i = sizeof(nnue::Header); i + 1 < data.size(); i += 2) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+
+            const i16 value = i16(seed % 129) - 64;
+
+            std::memcpy(&data[i], &value, sizeof(value));
+        }
+
+        header.checksum = nnue::get_checksum(&data[sizeof(nnue::Header)], nnue::get_size<L>());
+
+        std::memcpy(data.data(), &header, sizeof(nnue::Header));
+
+        return data;
+    });
+};
+
+// Runs the checks with a random net of every shape, then goes back to the embedded net
+inline void layouts()
+{
+    for (usize shape = 0; shape < nnue::LAYOUT_COUNT; ++shape) {
+        const auto data = get_random(shape, 0x9E3779B97F4A7C15ULL + shape);
+
+        bool result = nnue::load(data.data(), data.size()) == nnue::Error::NONE && nnue::shape == shape;
+
+        for (const auto& test : set) {
+            if (!result) {
+                break;
+            }
+
+            auto nnue = nnue::Net();
+            auto cached = nnue::Net();
+            auto board = Board(test.fen);
+
+            nnue.refresh(board);
+
+            result = check(board, nnue, 3) && check_cache(board, cached, 2);
+        }
+
+        std::cout << std::endl;
+        std::cout << "layout " << shape << std::endl;
+        std::cout << (result ? "passed!" : "failed!") << std::endl;
+    }
+
+    nnue::init();
+};
+
+// Loads net files through the file mapping, broken files must be rejected
+inline void files()
+{
+    const auto path = (std::filesystem::temp_directory_path() / "iris_test.nnue").string();
+
+    auto write = [&] (const std::vector<u8>& data) {
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    };
+
+    auto data = get_random(2, 0x2545F4914F6CDD1DULL);
+
+    write(data);
+
+    bool result = nnue::load(path) == nnue::Error::NONE && nnue::shape == 2;
+
+    data[sizeof(nnue::Header) + 1000] ^= 1;
+    write(data);
+
+    result &= nnue::load(path) == nnue::Error::CHECKSUM;
+
+    data.pop_back();
+    write(data);
+
+    result &= nnue::load(path) == nnue::Error::SIZE;
+
+    std::filesystem::remove(path);
+
+    result &= nnue::load(path) == nnue::Error::FILE;
+
+    // Failed loads keep the last net
+    result &= nnue::shape == 2;
+
+    nnue::init();
+
+    std::cout << std::endl;
+    std::cout << "files" << std::endl;
+    std::cout << (result ? "passed!" : "failed!") << std::endl;
+};
+
+// Quantizes a net whose weights fit in int8, the evals must stay exact through a save and a reload
+inline void quantized()
+{
+    const auto path = (std::filesystem::temp_directory_path() / "iris_test_int8.nnue").string();
+    const auto data = get_random(4, 0x853C49E6748FEA9BULL);
+
+    auto get_evals = [] () {
+        std::vector<i32> evals;
+
+        for (const auto& test : set) {
+            auto nnue = nnue::Net();
+            auto board = Board(test.fen);
+
+            nnue.refresh(board);
+            evals.push_back(nnue.get_eval(board));
+
+            for (const auto& move : move::gen::get<move::gen::type::ALL>(board)) {
+                if (!board.is_legal(move)) {
+                    continue;
+                }
+
+                nnue.make(board, move);
+                board.make(move);
+
+                evals.push_back(nnue.get_eval(board));
+
+                nnue.unmake();
+                board.unmake(move);
+            }
+        }
+
+        return evals;
+    };
+
+    bool result = nnue::load(data.data(), data.size()) == nnue::Error::NONE;
+
+    const auto evals = get_evals();
+
+    result &= nnue::quantize() == 0 && nnue::shape == nnue::get_layout_index<std::tuple_element_t<4, nnue::Layouts>::Quantized>();
+    result &= get_evals() == evals;
+
+    result &= nnue::save(path) && nnue::load(path) == nnue::Error::NONE;
+    result &= get_evals() == evals;
+
+    std::filesystem::remove(path);
+
+    nnue::init();
+
+    std::cout << std::endl;
+    std::cout << "quantized" << std::endl;
+    std::cout << (result ? "passed!" : "failed!") << std::endl;
+};
+
+// Evaluates positions in batches with a random net of every shape, the evals must match the ones of a network
+inline void batch()
+{
+    bool result = true;
+
+    for (usize shape = 0; shape < nnue::LAYOUT_COUNT && result; ++shape) {
+        const auto data = get_random(shape, 0xDA942042E4DD58B5ULL + shape);
+
+        result &= nnue::load(data.data(), data.size()) == nnue::Error::NONE;
+
+        std::vector<Board> boards;
+        std::vector<i32> evals;
+
+        for (const auto& test : set) {
+            auto board = Board(test.fen);
+
+            boards.push_back(board);
+
+            for (const auto& move : move::gen::get<move::gen::type::ALL>(board)) {
+                if (!board.is_legal(move)) {
+                    continue;
+                }
+
+                board.make(move);
+                boards.push_back(board);
+                board.unmake(move);
+            }
+        }
+
+        for (auto& board : boards) {
+            auto nnue = nnue::Net();
+
+            nnue.refresh(board);
+            evals.push_back(nnue.get_eval(board));
+        }
+
+        std::vector<nnue::Position> positions;
+
+        for (auto& board : boards) {
+            positions.push_back(nnue::get_position(board));
+        }
+
+        auto batch = std::vector<i32>(boards.size());
+
+        nnue::evaluate(positions, batch, 3);
+
+        result &= batch == evals;
+    }
+
+    nnue::init();
+
+    // Lines the batch eval can't read are skipped, only the valid ones are written back
+    const auto in = (std::filesystem::temp_directory_path() / "iris_test_batch.txt").string();
+    const auto out = (std::filesystem::temp_directory_path() / "iris_test_batch_out.txt").string();
+
+    std::ofstream(in) <<
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 | 0 | 0.5\n"
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQQBNR w kq - 0 1\n"
+        "rnbqkbnr/pppppppp/pppppppp/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1\n"
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP w KQkq - 0 1\n"
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1\n"
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq z9 0 1\n"
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - x 1\n"
+        "4k3/8/8/8/8/8/8/4K3 b - -\n";
+
+    const auto invalid = datagen::batch::run(in, out, 2);
+
+    usize lines = 0;
+    std::string line;
+    std::ifstream output(out);
+
+    while (std::getline(output, line))
+    {
+        lines += 1;
+    }
+
+    output.close();
+
+    result &= invalid == 6 && lines == 2;
+
+    std::filesystem::remove(in);
+    std::filesystem::remove(out);
+
+    std::cout << std::endl;
+    std::cout << "batch" << std::endl;
+    std::cout << (result ? "passed!" : "failed!") << std::endl;
+};
+
 inline void test()
 {
     std::cout << "MOVE GEN TYPE TEST" << std::endl;
@@ -74,7 +436,9 @@ inline void test()
 
         nnue.refresh(board);
 
-        auto result = check(board, nnue, test.depth);
+        auto cached = nnue::Net();
+
+        auto result = check(board, nnue, test.depth) && check_cache(board, cached, 3) && check_arch(board, 3);
 
         std::cout << std::endl;
         std::cout << test.name << std::endl;
@@ -86,6 +450,11 @@ inline void test()
             std::cout << "failed!" << std::endl;
         }
     }
+
+    layouts();
+    files();
+    quantized();
+    batch();
 };
 
 };
\ No newline at end of file
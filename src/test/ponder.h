@@ -0,0 +1,79 @@
+#pragma once
+
+#include "../engine/search.h"
+
+namespace test::ponder
+{
+
+struct Test
+{
+    std::string fen;
+    std::string go;
+    std::string expected;
+};
+
+// Searches that stop by themselves, the best move must still wait for ponderhit or stop
+inline std::vector<Test> set = {
+    { "6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1", "go ponder mate 1", "bestmove a1a8" },
+    { "6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1", "go ponder mate 1 depth 4", "bestmove a1a8" },
+    { "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", "go ponder nodes 1000", "bestmove " }
+};
+
+// Pondering ends with ponderhit for the first test and with stop for the others
+inline bool check(const Test& test, bool is_hit)
+{
+    auto engine = search::Engine();
+    engine.set({ .hash = 16, .threads = 1 });
+    engine.clear();
+
+    auto board = Board(test.fen);
+    auto output = std::stringstream();
+    auto buffer = std::cout.rdbuf(output.rdbuf());
+
+    engine.search<false>(board, uci::parse::go(test.go, board).value());
+
+    // The search has long found the mate or hit its node limit by now
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    const bool is_waiting = engine.workers[0]->is_busy();
+
+    if (is_hit) {
+        engine.ponderhit();
+        engine.join();
+    }
+    else {
+        engine.stop();
+    }
+
+    std::cout.rdbuf(buffer);
+
+    const bool result = is_waiting && output.str().find(test.expected) != std::string::npos;
+
+    if (!result) {
+        std::cout << "ERROR: " << test.go << " in " << test.fen << (is_waiting ? " gave no " + test.expected : " sent its best move early") << std::endl;
+    }
+
+    return result;
+};
+
+inline void test()
+{
+    std::cout << "PONDER TEST" << std::endl;
+
+    bool result = true;
+
+    for (usize i = 0; i < set.size(); ++i) {
+        result &= ponder::check(set[i], i == 0);
+    }
+
+    std::cout << std::endl;
+
+    if (result) {
+        std::cout << "passed!" << std::endl;
+    }
+    else {
+        std::cout << "failed!" << std::endl;
+    }
+};
+
+};
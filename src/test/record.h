@@ -0,0 +1,278 @@
+#pragma once
+
+#include <filesystem>
+
+#include "../datagen/game.h"
+
+namespace test::record
+{
+
+inline std::vector<std::string> set = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+    "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 47 210"
+};
+
+// Packs every position within 2 plies of the set, the records must give back the same fen and pieces
+inline bool check(Board& board, i32 ply, std::vector<datagen::format::Record>& records, std::vector<std::string>& fens)
+{
+    const auto record = datagen::format::pack(board, i32(fens.size()) - 1000, u8(fens.size() % 3));
+    const auto position = datagen::format::get_position(record);
+    const auto expected = nnue::get_position(board);
+
+    records.push_back(record);
+    fens.push_back(board.get_fen());
+
+    if (datagen::format::get_fen(record) != fens.back() ||
+        !std::equal(position.pieces, position.pieces + 6, expected.pieces) ||
+        !std::equal(position.colors, position.colors + 2, expected.colors) ||
+        position.color != expected.color) {
+        return false;
+    }
+
+    if (ply == 0) {
+        return true;
+    }
+
+    for (const u16& move : move::gen::get<move::gen::type::ALL>(board)) {
+        if (!board.is_legal(move)) {
+            continue;
+        }
+
+        board.make(move);
+
+        const bool result = record::check(board, ply - 1, records, fens);
+
+        board.unmake(move);
+
+        if (!result) {
+            return false;
+        }
+    }
+
+    return true;
+};
+
+// Plays the first legal moves in turn from the position, every position must come back from the replayed game
+inline bool check_game(Board& board, std::vector<datagen::format::Game>& games, std::vector<std::vector<datagen::format::Record>>& expected)
+{
+    auto game = datagen::format::Game();
+    std::vector<datagen::format::Record> records;
+
+    game.start = datagen::format::pack(board, 0, u8(games.size() % 3));
+
+    for (i32 i = 0; i < 60; ++i) {
+        const auto moves = move::gen::get_legal(board);
+
+        if (moves.size() == 0) {
+            break;
+        }
+
+        const u16 move = moves[usize(i) % moves.size()];
+        const i32 score = i * 7 - 200;
+
+        records.push_back(datagen::format::pack(board, score, game.start.result));
+        game.moves.push_back({ .move = move, .score = i16(score) });
+
+        board.make(move);
+    }
+
+    games.push_back(game);
+    expected.push_back(records);
+
+    // Replays it with another board
+    auto replay = Board();
+    usize i = 0;
+    bool result = true;
+
+    datagen::format::replay(game, replay, [&] (Board& position, u16, i16 score) {
+        const auto record = datagen::format::pack(position, score, game.start.result);
+
+        result &= i < records.size() && std::memcmp(&record, &records[i], sizeof(datagen::format::Record)) == 0;
+        i += 1;
+    });
+
+    return result && i == records.size();
+};
+
+// Plays a mate in one without adjudication, the game must end on the mate with the winner's result
+inline bool check_mate(const std::string& fen, datagen::game::Wdl expected)
+{
+    auto board = Board(fen);
+    auto players = std::array<datagen::game::Player, 2>();
+    auto config = datagen::Config();
+
+    config.win_score = INT32_MAX;
+
+    const auto result = datagen::game::run(board, players, config);
+
+    const u8 expected_result = expected == datagen::game::Wdl::WIN ? datagen::format::result::WIN : datagen::format::result::LOSS;
+
+    return result.wdl == expected && result.game.moves.size() == 1 && result.game.start.result == expected_result;
+};
+
+inline void test()
+{
+    std::cout << "RECORD TEST" << std::endl;
+
+    const auto path = (std::filesystem::temp_directory_path() / "iris_test_record.bin").string();
+
+    std::vector<datagen::format::Record> records;
+    std::vector<std::string> fens;
+
+    bool result = true;
+
+    for (const auto& fen : set) {
+        auto board = Board(fen);
+
+        result &= record::check(board, 2, records, fens);
+    }
+
+    // Writes the records and reads them back as text
+    std::filesystem::remove(path);
+
+    {
+        auto writer = datagen::format::Writer(path);
+
+        for (const auto& record : records) {
+            writer.write(record);
+        }
+    }
+
+    std::vector<datagen::format::Record> reads;
+
+    auto reader = datagen::format::Reader(path);
+
+    result &= reader.read(reads, records.size() + 1) == records.size();
+
+    for (usize i = 0; i < reads.size() && result; ++i) {
+        result &= std::memcmp(&reads[i], &records[i], sizeof(datagen::format::Record)) == 0;
+        result &= datagen::format::get_text(reads[i]).starts_with(fens[i] + " | " + std::to_string(i32(i) - 1000) + " | ");
+    }
+
+    std::filesystem::remove(path);
+
+    // Writes games and reads their positions back
+    std::vector<datagen::format::Game> games;
+    std::vector<std::vector<datagen::format::Record>> expected;
+
+    for (const auto& fen : set) {
+        auto board = Board(fen);
+
+        result &= record::check_game(board, games, expected);
+    }
+
+    {
+        auto writer = datagen::format::Writer(path);
+
+        for (const auto& game : games) {
+            writer.write(game);
+        }
+    }
+
+    auto game_reader = datagen::format::Reader(path);
+    auto game = datagen::format::Game();
+    auto board = Board();
+    usize game_count = 0;
+
+    while (game_reader.read(game) && result)
+    {
+        std::vector<datagen::format::Record> kept;
+
+        result &= game_count < games.size() && game.moves.size() == games[game_count].moves.size();
+
+        datagen::format::get_records(game, board, kept);
+
+        // The kept positions are the expected ones that are quiet and not in check
+        usize k = 0;
+
+        for (usize i = 0; i < expected[game_count].size() && result; ++i) {
+            auto position = Board(datagen::format::get_fen(expected[game_count][i]));
+
+            if (!datagen::format::is_kept(position, game.moves[i].move)) {
+                continue;
+            }
+
+            result &= k < kept.size() && std::memcmp(&kept[k], &expected[game_count][i], sizeof(datagen::format::Record)) == 0;
+            k += 1;
+        }
+
+        result &= k == kept.size();
+        game_count += 1;
+    }
+
+    result &= game_count == games.size();
+
+    std::filesystem::remove(path);
+
+    // Splits the records into shards, merging and shuffling them must keep every record
+    std::vector<std::string> shards = { path + "0", path + "1" };
+
+    for (usize i = 0; i < shards.size(); ++i) {
+        std::filesystem::remove(shards[i]);
+
+        auto writer = datagen::format::Writer(shards[i]);
+
+        for (usize k = i; k < records.size(); k += shards.size()) {
+            writer.write(records[k]);
+        }
+    }
+
+    for (const bool shuffle : { false, true }) {
+        result &= datagen::format::merge(shards, path, shuffle).value_or(0) == records.size() * sizeof(datagen::format::Record);
+
+        auto merge_reader = datagen::format::Reader(path);
+        std::vector<datagen::format::Record> merged;
+
+        merge_reader.read(merged, records.size() + 1);
+
+        auto less = [] (const datagen::format::Record& a, const datagen::format::Record& b) {
+            return std::memcmp(&a, &b, sizeof(datagen::format::Record)) < 0;
+        };
+
+        auto sorted = records;
+
+        std::sort(sorted.begin(), sorted.end(), less);
+        std::sort(merged.begin(), merged.end(), less);
+
+        result &= merged.size() == sorted.size() && std::memcmp(merged.data(), sorted.data(), merged.size() * sizeof(datagen::format::Record)) == 0;
+    }
+
+    // Merging into one of the shards or shuffling games must fail without touching the shards
+    const auto shard_size = std::filesystem::file_size(shards[0]);
+
+    result &= !datagen::format::merge(shards, shards[0], false).has_value();
+    result &= std::filesystem::file_size(shards[0]) == shard_size;
+
+    std::filesystem::remove(path + ".games");
+    std::filesystem::copy_file(shards[0], path + ".games");
+
+    result &= !datagen::format::merge({ path + ".games" }, path, true).has_value();
+
+    std::filesystem::remove(path + ".games");
+
+    for (const auto& shard : shards) {
+        std::filesystem::remove(shard);
+    }
+
+    std::filesystem::remove(path);
+
+    // Mates by either side
+    result &= record::check_mate("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1", datagen::game::Wdl::WIN);
+    result &= record::check_mate("r5k1/8/8/8/8/8/5PPP/6K1 b - - 0 1", datagen::game::Wdl::LOSS);
+
+    std::cout << std::endl;
+    std::cout << "positions: " << records.size() << std::endl;
+    std::cout << "games: " << game_count << std::endl;
+
+    if (result) {
+        std::cout << "passed!" << std::endl;
+    }
+    else {
+        std::cout << "failed!" << std::endl;
+    }
+};
+
+};
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "../engine/search.h"
+
+namespace test::table
+{
+
+constexpr u64 TABLE_SIZE = 1;
+constexpr u64 ITERATIONS = 1ULL << 22;
+constexpr u64 KEYS = 1ULL << 16;
+
+// Every entry's content is derived from its bucket and its 16-bit hash, so any hit whose content
+// doesn't match must have been assembled from different writes
+inline u64 get_mix(u64 x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+
+    return x ^ (x >> 31);
+};
+
+inline void test()
+{
+    std::cout << "TRANSPOSITION TABLE STRESS TEST" << std::endl;
+
+    auto table = transposition::Table();
+    table.init(TABLE_SIZE);
+    table.clear();
+
+    const u64 thread_count = std::max(u64(std::thread::hardware_concurrency()), u64(4));
+
+    std::atomic<u64> reads = 0;
+    std::atomic<u64> hits = 0;
+    std::atomic<u64> inconsistents = 0;
+
+    std::vector<std::thread> threads;
+
+    for (u64 i = 0; i < thread_count; ++i) {
+        threads.emplace_back([&] (u64 id) {
+            u64 seed = get_mix(id + 1);
+
+            for (u64 k = 0; k < ITERATIONS; ++k) {
+                seed = get_mix(seed);
+
+                // Draws from a small set of positions so that threads hit the same entries often
+                const u64 hash = get_mix(seed % KEYS);
+
+                // Empty entries have a zero hash
+                if (static_cast<u16>(hash) == 0) {
+                    continue;
+                }
+
+                const u64 content = get_mix((table.get_index(hash) << 16) | static_cast<u16>(hash));
+
+                const u16 move = static_cast<u16>(content) | 1;
+                const i32 score = i32((content >> 16) % 2000) - 1000;
+                const i32 eval = i32((content >> 32) % 2000) - 1000;
+                const i32 depth = i32((content >> 48) % 100) + 1;
+
+                auto [hit, entry] = table.get(hash);
+
+                // Writes
+                if (k & 1) {
+                    entry.set(hash, move, score, eval, depth, table.age, false, transposition::bound::EXACT, 0);
+                    continue;
+                }
+
+                // Reads
+                reads += 1;
+
+                if (!hit) {
+                    continue;
+                }
+
+                hits += 1;
+
+                if (entry.get_move() != move ||
+                    entry.get_score(0) != score ||
+                    entry.get_eval() != eval ||
+                    entry.get_depth() != depth) {
+                    inconsistents += 1;
+                }
+            }
+        }, i);
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    std::cout << std::endl;
+    std::cout << "threads: " << thread_count << std::endl;
+    std::cout << "reads: " << reads << std::endl;
+    std::cout << "hits: " << hits << std::endl;
+    std::cout << "inconsistent: " << inconsistents << std::endl;
+
+    if (inconsistents == 0) {
+        std::cout << "passed!" << std::endl;
+    }
+    else {
+        std::cout << "failed!" << std::endl;
+    }
+};
+
+};
\ No newline at end of file
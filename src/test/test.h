@@ -8,6 +8,10 @@
 #include "see.h"
 #include "bench.h"
 #include "nnue.h"
+#include "table.h"
+#include "record.h"
+#include "book.h"
+#include "ponder.h"
 
 namespace test
 {
@@ -22,6 +26,10 @@ inline void test()
     test::static_exchange::test();
     test::bench::test();
     test::nn::test();
+    test::table::test();
+    test::record::test();
+    test::book::test();
+    test::ponder::test();
 };
 
 };
\ No newline at end of file
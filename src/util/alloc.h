@@ -6,6 +6,9 @@
 #include <cstddef>
 #include <cstdlib>
 #include <cassert>
+#include <fstream>
+#include <string>
+#include <utility>
 
 #if defined(__linux__)
 #include <sys/mman.h>
@@ -13,6 +16,14 @@
 
 using usize = size_t;
 
+enum class Page
+{
+    NORMAL,
+    TRANSPARENT,
+    HUGE_2MB,
+    HUGE_1GB
+};
+
 inline void* malloc_aligned(usize alignment, usize size)
 {
     void* ptr;
@@ -41,4 +52,115 @@ inline void free_aligned(void* ptr)
 #else
 #error "Unsupported complier!"
 #endif
+};
+
+inline usize get_page_size(Page page)
+{
+    switch (page)
+    {
+    case Page::HUGE_2MB:
+        return 1ULL << 21;
+    case Page::HUGE_1GB:
+        return 1ULL << 30;
+    default:
+        return 1;
+    }
+};
+
+inline std::string get_page_name(Page page)
+{
+    switch (page)
+    {
+    case Page::TRANSPARENT:
+        return "transparent huge pages";
+    case Page::HUGE_2MB:
+        return "2MB huge pages";
+    case Page::HUGE_1GB:
+        return "1GB huge pages";
+    default:
+        return "normal pages";
+    }
+};
+
+// Checks if the kernel will back madvise'd memory with transparent huge pages
+inline bool has_transparent_huge_pages()
+{
+#if defined(__linux__)
+    std::ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string line;
+
+    if (!file.is_open() || !std::getline(file, line)) {
+        return false;
+    }
+
+    return line.find("[never]") == std::string::npos;
+#else
+    return false;
+#endif
+};
+
+// Tries explicit huge pages (hugetlbfs) first if requested, then falls back to
+// transparent huge pages and normal pages
+inline void* malloc_huge(usize size, bool explicit_huge, Page& page)
+{
+#if defined(__linux__) && defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+    if (explicit_huge) {
+        for (auto [type, shift] : { std::pair { Page::HUGE_1GB, 30 }, std::pair { Page::HUGE_2MB, 21 } }) {
+            const usize page_size = get_page_size(type);
+
+            // Don't waste a whole 1GB page on a small table
+            if (size < page_size && type == Page::HUGE_1GB) {
+                continue;
+            }
+
+            const usize rounded = (size + page_size - 1) / page_size * page_size;
+
+            void* ptr = mmap(
+                nullptr,
+                rounded,
+                PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (shift << MAP_HUGE_SHIFT),
+                -1,
+                0
+            );
+
+            if (ptr != MAP_FAILED) {
+                page = type;
+                return ptr;
+            }
+        }
+    }
+#else
+    (void)explicit_huge;
+#endif
+
+#if defined(__linux__)
+    const usize alignment = 1ULL << 21;
+#else
+    const usize alignment = 1ULL << 12;
+#endif
+
+    // Sizes must be a multiple of the alignment
+    const usize rounded = (size + alignment - 1) / alignment * alignment;
+
+    page = has_transparent_huge_pages() ? Page::TRANSPARENT : Page::NORMAL;
+
+    return malloc_aligned(alignment, rounded);
+};
+
+inline void free_huge(void* ptr, usize size, Page page)
+{
+#if defined(__linux__)
+    if (page == Page::HUGE_2MB || page == Page::HUGE_1GB) {
+        const usize page_size = get_page_size(page);
+
+        munmap(ptr, (size + page_size - 1) / page_size * page_size);
+
+        return;
+    }
+#else
+    (void)size;
+#endif
+
+    free_aligned(ptr);
 };
\ No newline at end of file
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+using usize = size_t;
+
+namespace cpu
+{
+
+// Instruction sets of the simd kernels, ordered from the oldest to the newest
+enum class Arch
+{
+    SCALAR,
+    SSE41,
+    AVX2,
+    AVX512,
+    VNNI
+};
+
+constexpr Arch ARCHS[] = { Arch::SCALAR, Arch::SSE41, Arch::AVX2, Arch::AVX512, Arch::VNNI };
+
+// Kernels in use, chosen once at startup
+inline Arch arch = Arch::SCALAR;
+inline bool pext = false;
+inline bool popcnt = false;
+
+inline bool is_supported(Arch target)
+{
+#if defined(__x86_64__) && defined(__GNUC__)
+    __builtin_cpu_init();
+
+    switch (target)
+    {
+    case Arch::SCALAR:
+        return true;
+    case Arch::SSE41:
+        return __builtin_cpu_supports("sse4.1");
+    case Arch::AVX2:
+        return __builtin_cpu_supports("avx2");
+    case Arch::AVX512:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+    case Arch::VNNI:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vnni");
+    }
+#endif
+
+    return target == Arch::SCALAR;
+};
+
+// Pext is microcoded and slower than magics on amd cpus before zen 3
+inline bool is_pext_fast()
+{
+#if defined(__x86_64__) && defined(__GNUC__)
+    __builtin_cpu_init();
+
+    return __builtin_cpu_supports("bmi2") && !__builtin_cpu_is("znver1") && !__builtin_cpu_is("znver2");
+#else
+    return false;
+#endif
+};
+
+inline std::string get_name(Arch target)
+{
+    switch (target)
+    {
+    case Arch::SCALAR:
+        return "scalar";
+    case Arch::SSE41:
+        return "sse4.1";
+    case Arch::AVX2:
+        return "avx2";
+    case Arch::AVX512:
+        return "avx512";
+    case Arch::VNNI:
+        return "avx512 vnni";
+    }
+
+    return "unknown";
+};
+
+inline std::string get_name()
+{
+    return get_name(arch) + (pext ? " + bmi2" : "");
+};
+
+// Forces the given kernels, falls back to the best supported ones
+inline void set(Arch forced, bool forced_pext)
+{
+    arch = Arch::SCALAR;
+
+    for (const auto candidate : ARCHS) {
+        if (candidate <= forced && is_supported(candidate)) {
+            arch = candidate;
+        }
+    }
+
+    pext = forced_pext && is_pext_fast();
+};
+
+inline bool is_popcnt_supported()
+{
+#if defined(__x86_64__) && defined(__GNUC__)
+    __builtin_cpu_init();
+
+    return __builtin_cpu_supports("popcnt");
+#else
+    return false;
+#endif
+};
+
+inline void init()
+{
+    cpu::set(Arch::VNNI, true);
+
+    popcnt = is_popcnt_supported();
+};
+
+};
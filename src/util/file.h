@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <optional>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using usize = size_t;
+
+namespace file
+{
+
+// Read only view of a whole file, the pages are shared with the os file cache
+struct Mapping
+{
+    const uint8_t* data = nullptr;
+    usize size = 0;
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE map = nullptr;
+#endif
+};
+
+inline std::optional<Mapping> map(const std::string& path)
+{
+    Mapping mapping = Mapping();
+
+#if defined(_WIN32)
+    mapping.file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (mapping.file == INVALID_HANDLE_VALUE) {
+        return {};
+    }
+
+    LARGE_INTEGER size;
+
+    if (!GetFileSizeEx(mapping.file, &size) || size.QuadPart == 0) {
+        CloseHandle(mapping.file);
+        return {};
+    }
+
+    mapping.map = CreateFileMappingA(mapping.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (mapping.map == nullptr) {
+        CloseHandle(mapping.file);
+        return {};
+    }
+
+    mapping.data = static_cast<const uint8_t*>(MapViewOfFile(mapping.map, FILE_MAP_READ, 0, 0, 0));
+    mapping.size = usize(size.QuadPart);
+
+    if (mapping.data == nullptr) {
+        CloseHandle(mapping.map);
+        CloseHandle(mapping.file);
+        return {};
+    }
+#elif defined(__unix__) || defined(__APPLE__)
+    const int fd = open(path.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        return {};
+    }
+
+    struct stat status;
+
+    if (fstat(fd, &status) != 0 || status.st_size <= 0) {
+        close(fd);
+        return {};
+    }
+
+    void* ptr = mmap(nullptr, usize(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping stays valid after the file is closed
+    close(fd);
+
+    if (ptr == MAP_FAILED) {
+        return {};
+    }
+
+    madvise(ptr, usize(status.st_size), MADV_WILLNEED);
+
+    mapping.data = static_cast<const uint8_t*>(ptr);
+    mapping.size = usize(status.st_size);
+#else
+    (void)path;
+    return {};
+#endif
+
+    return mapping;
+};
+
+inline void unmap(Mapping& mapping)
+{
+    if (mapping.data == nullptr) {
+        return;
+    }
+
+#if defined(_WIN32)
+    UnmapViewOfFile(mapping.data);
+    CloseHandle(mapping.map);
+    CloseHandle(mapping.file);
+#elif defined(__unix__) || defined(__APPLE__)
+    munmap(const_cast<uint8_t*>(mapping.data), mapping.size);
+#endif
+
+    mapping = Mapping();
+};
+
+};
\ No newline at end of file
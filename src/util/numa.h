@@ -0,0 +1,127 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+using usize = size_t;
+
+namespace numa
+{
+
+// Cpus of each numa node, empty if the topology is unknown
+inline std::vector<std::vector<usize>> nodes;
+
+// Parses a list such as "0-3,8-11", used for both cpus and node ids
+inline std::vector<usize> get_cpus(const std::string& str)
+{
+    std::vector<usize> cpus;
+    std::stringstream ss(str);
+    std::string token;
+
+    while (std::getline(ss, token, ','))
+    {
+        if (token.empty()) {
+            continue;
+        }
+
+        const auto dash = token.find('-');
+        const usize first = std::stoull(token.substr(0, dash));
+        const usize last = dash == std::string::npos ? first : std::stoull(token.substr(dash + 1));
+
+        for (usize cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+
+    return cpus;
+};
+
+inline void init()
+{
+    nodes.clear();
+
+#if defined(__linux__)
+    // Node ids can have gaps, so the online ones are listed instead of probing them in order
+    std::ifstream online("/sys/devices/system/node/online");
+
+    if (!online.is_open()) {
+        return;
+    }
+
+    std::string ids;
+    std::getline(online, ids);
+
+    for (const auto i : get_cpus(ids)) {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(i) + "/cpulist");
+
+        if (!file.is_open()) {
+            continue;
+        }
+
+        std::string line;
+        std::getline(file, line);
+
+        auto cpus = get_cpus(line);
+
+        // Memory only nodes have no cpus
+        if (!cpus.empty()) {
+            nodes.push_back(cpus);
+        }
+    }
+#endif
+};
+
+inline usize get_count()
+{
+    return std::max(nodes.size(), usize(1));
+};
+
+// Threads are spread over the nodes in a round robin fashion
+inline usize get_node(usize thread_id)
+{
+    return thread_id % get_count();
+};
+
+// Binds the calling thread to the cpus of the node assigned to this thread id
+inline void bind(usize thread_id)
+{
+    if (nodes.size() < 2) {
+        return;
+    }
+
+#if defined(__linux__)
+    // Cpu ids can go past CPU_SETSIZE on large machines, so the set is sized for the largest one
+    const auto& cpus = nodes[get_node(thread_id)];
+    const usize count = *std::max_element(cpus.begin(), cpus.end()) + 1;
+
+    cpu_set_t* set = CPU_ALLOC(count);
+
+    if (set == nullptr) {
+        return;
+    }
+
+    const usize size = CPU_ALLOC_SIZE(count);
+
+    CPU_ZERO_S(size, set);
+
+    for (const auto cpu : cpus) {
+        CPU_SET_S(cpu, size, set);
+    }
+
+    sched_setaffinity(0, size, set);
+
+    CPU_FREE(set);
+#endif
+};
+
+};
\ No newline at end of file